@@ -25,89 +25,129 @@ Hungarian notation:
 #include "SENSE.h"
 
 
-volatile time_date tTime;				///< The actual RTC time.
-volatile time_date tTimeEditing;		///< The value which the RTC will be set to.
+/* RTC: the interrupt only counts, calendar fields are derived by getTime(). */
+volatile longword lEpoch;				///< Seconds since 01/01/2000 00:00:00.
+volatile word wRtcMinOfDay;				///< Minutes since midnight.
+volatile byte bRtcSec;					///< Seconds of the current minute.
+volatile word wRtcMilli;				///< Hundredths of second (RTC_TIMER0 only).
+volatile byte bTimeSeq;					///< Sequence counter of the RTC, odd while the interrupt updates it.
+longword lCachedMidnight=0xFFFFFFFF;	///< Epoch of the midnight of the cached day (main only).
+byte bCachedDay, bCachedMonth, bCachedYear;
 
-volatile count cButtonIntegrator;		///< Keeps track of the time a button is being pressed.
+/**
+ * \brief Keys recognised by the button scan, single buttons and chords alike.
+ *
+ * Chords come first: when one is pressed it silences the keys it is made of.
+ */
+const key_desc kdKeys[NUMBER_OF_KEYS]={
+//	  bMask					bCode		bLongCode
+	{ BUTTON_A|BUTTON_B,	BTN_AB,		BTN_AB_LONG	},
+	{ BUTTON_A,				BTN_A,		KEY_REPEAT	},		// UP
+	{ BUTTON_B,				BTN_B,		KEY_REPEAT	},		// DOWN
+	{ BUTTON_C,				BTN_C,		BTN_C_LONG	}		// MENU
+};
+key_state ksKeys[NUMBER_OF_KEYS];		///< Press/long/repeat state machine of every key.
+volatile byte bKeysDebounced;			///< Debounced BUTTON_PINS, bit=1 --> pressed.
+byte bVCount0, bVCount1;				///< Vertical counter: bit i of the two bytes counts the samples of pin i.
 
-volatile byte bTimeChanged;				///< Reports time is changed and quotes have to be refreshed
-volatile byte bDateChanged;				///< Reports date has changed.
-volatile byte bTempChanged;				///< Reports temperature has changed.
-volatile byte bHumChanged;				///< Reports humidity has changed.
 volatile byte bPrintQuotes;				///< Reports that quotes has to be printed.
 
 
 volatile word wADC_garbage;				///< Garbage counter for ADC samples.
 volatile word wADC_counts;				///< Counter for ADC samples.
-volatile byte bChannel;					///< ADC channel selector value.
+volatile byte bChannel;					///< Index into acChannels[] of the channel being converted.
+volatile byte bDiscard;					///< Conversions still to be thrown away on the current channel.
 
-volatile word wBacklightCounter;		///< Time counter for backlight.
+volatile word wTicks;					///< Free running 10 ms counter, timestamps the button presses.
+soft_timer tmBacklight;					///< Backlight timeout, one-shot.
+soft_timer tmColon;						///< Clock colon blink, 1 Hz.
 
 
 /**
- *	\brief Temperature samples array.
- *	
- *	Array kept in memory in order to store the acquired temperature samples;
- *	every NUMBER_OF_CONVERSIONS the average of these values will be calculated,
- *	and the variable dTemperature will be assigned.
- *	\sa NUMBER_OF_CONVERSION
- *	\sa dTemperature
-*/
-volatile float fTemperature;
+ * \brief ADC channel descriptors, in scan order.
+ *
+ * Every START_ADC() converts all the enabled channels in one pass, then the
+ * interrupt stops until the next acquisition. Indexes are the ADC_CH_* values.
+ */
+adc_channel acChannels[ADC_NUMBER_OF_CHANNELS]={
+	/*	mux					conversion			reference				discard	enabled					deadband */
+	{	ADC_MUX_ADC1,		getTemperature,		ADC_CH_TEMPERATURE,		1,		1,						5		},	// 0.5 degC
+	{	ADC_MUX_ADC0,		getHumidity,		ADC_CH_TEMPERATURE,		1,		1,						20		},	// 2.0 %RH
+	{	ADC_MUX_ADC3,		getTemperature,		ADC_CH_TEMPERATURE_2,	1,		PROBE_2_ENABLED,		5		},
+	{	ADC_MUX_ADC2,		getHumidity,		ADC_CH_TEMPERATURE_2,	1,		PROBE_2_ENABLED,		20		},
+	{	ADC_MUX_BANDGAP,	getSupplyVoltage,	ADC_CH_SUPPLY,			2,		SUPPLY_MONITOR_ENABLED,	200		}	// bandgap needs to settle; 200 mV
+};
 
 /**
- * \brief Humidity samples array.
- *
- *  Array kept in memory in order to store the acquired humidity samples;
- *	every NUMBER_OF_CONVERSIONS the average of these values will be calculated,
- *	and the variable fHumidity will be assigned.
- *	\sa NUMBER_OF_CONVERSION
- *	\sa dHumidity
+ * \brief Last value of every channel, tenths of unit (mV for the supply).
  */
-volatile float fHumidity;				///< Humidity measured.
+volatile int16_t iaChannelValue[ADC_NUMBER_OF_CHANNELS];
+volatile int16_t iaLastLogged[ADC_NUMBER_OF_CHANNELS];		///< Channel values when the last record was triggered.
+byte bLastLoggedSet;					///< iaLastLogged[] holds a real scan: 0 at power-up and when the deadband mode is entered.
+
+volatile int16_t iDewPoint;				///< Dew point derived from the last acquisition, tenths of degree.
+volatile word wAbsHumidity;				///< Absolute humidity derived from the last acquisition, tenths of g/m^3.
 
 //volatile daily_log dlDataLog;			// Struct containing humidity and temperature logs.
 
 volatile word wLoggedDays;				///< Number of days until last EEPROM export.
-volatile byte bTodayLogs;				///< Number of logs taken today.
+volatile word wTodayLogs;				///< Number of logs taken today.
 volatile longword lLastIndex;			///< Address of the next byte to be written into EEPROM (first FREE byte).
 
-volatile byte bFirstConversion=1;
+volatile word wLogInterval;				///< Minutes between two log records (one of waLogIntervals[]).
+soft_timer tmSample;					///< Acquisition between two log points, every SAMPLE_PERIOD_S.
+byte bLogPending;						///< A log record is due: it will be written after the next acquisition.
+volatile byte bLogMode;					///< LOG_MODE_PERIODIC or LOG_MODE_DEADBAND.
+soft_timer tmLogSilence;				///< LOG_MODE_DEADBAND: maximum silence since the last record.
+byte bSettingsDirty;					///< SETTING_* bits: changed from the menu, not queued for the EEPROM yet.
+byte bLogDay;							///< Day of the month of the last daily header written.
+running_stats rsaInterval[ADC_NUMBER_OF_CHANNELS];	///< Per channel statistics of the current log interval.
+running_stats rsDewInterval;			///< Dew point statistics of the current log interval.
+running_stats rsHumToday;				///< Humidity statistics since midnight.
+running_stats rsTempToday;				///< Temperature statistics since midnight.
+running_stats rsHumYesterday;			///< rsHumToday at the last midnight.
+running_stats rsTempYesterday;			///< rsTempToday at the last midnight.
+
 volatile byte bHumOverflow;				///< Needed for displaying correctly the humidity value onto the LCD.
 
 
 volatile byte bHumOnThreshold;
 volatile byte bHumAlarmThreshold;
-byte bHumOnThresholdEditing;
-byte bHumAlarmThresholdEditing;
 
 
-volatile byte bBtnAPressed;
-volatile byte bBtnBPressed;
-volatile byte bBtnCPressed;
-volatile byte bInhibite;
 volatile byte bPort;
 							
-volatile byte bSelectionMenu;
-volatile byte bSelectionMenuChanged;
 volatile byte bSelection;
 volatile byte bSelectionChanged;
-volatile byte bTimeCommaState;
-volatile byte bTimeColonToToggle;
-volatile byte bBacklightActive;
+trend_history thTemp;					///< Last temperature samples, for the trend view.
+trend_history thHum;					///< Last humidity samples, for the trend view.
+byte bDiagPage;							///< Page of the diagnostics screen.
+byte bStatsDetail;						///< Statistics page: 0 mean/min/max, 1 standard deviation and times of min/max.
+const editor_desc *pEditing;			///< Setting edited in STATE_EDIT (PROGMEM descriptor).
+
+longword lWakeUps;						///< Main loop passes started by an interrupt waking the CPU up.
+longword lWorkPasses;					///< Main loop passes that found something to do.
 
-volatile byte sreg;
-volatile byte bPriLev;
 volatile byte bState=STATE_IDLE;
-volatile byte bStateOld=STATE_IDLE;
-volatile byte bBtn;
+volatile byte bBtn;						///< Button being handled by the state machine, taken from the button ring.
+button_event beButton;					///< Last press taken from the button ring (timestamp and duration).
+word wKeyLag;							///< Ticks the last press waited in the ring before the state machine took it.
 
 char str[17]="";
-char options[NUMBER_OF_OPTIONS+1][16]={"1.Soglia 1-DEUM","2.Soglia 2-ALL ", "3.Data         ",
-					"4.Ora          ", "5.hello       ", "6.world        ", "7.ciao         ", "              "};
+char *pStr;								///< End of the text composed so far in str[] by the fmt_*() formatters.
 
 
-byte baDays[12]={31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+/// What the menu entries open, indexed by bSelectionMenu (same order as options[]).
+const menu_item miMenu[NUMBER_OF_OPTIONS] PROGMEM={
+	{	STATE_EDIT,			edHumOn			},
+	{	STATE_EDIT,			edHumAl			},
+	{	STATE_EDIT,			edDate			},
+	{	STATE_EDIT,			edTime			},
+	{	STATE_EDIT,			edLogInterval	},
+	{	STATE_EDIT,			edLogMode		},
+	{	STATE_DIAGNOSTICS,	NULL			},
+	{	STATE_STATS,		NULL			}
+};
 
 	
 volatile longword i=0;
@@ -119,28 +159,49 @@ volatile longword i=0;
 /******************************************************************************/
 
 int main(void){
-	bPriLev=PRI_MAIN;
+	event evEvent;
+	menu_item miItem;
 	
 	_init_AVR();
 	
 	BACKLIGHT_ON();
 	
 	while(1) { /* Infinite Loop */
-			
+		
+		if( event_get(&evEvent) ){
+			PROF_ENTER(PROF_EVENTS);
+			vDispatch(&evEvent);
+			PROF_EXIT(PROF_EVENTS);
+		}
+		
+		PROF_ENTER(PROF_LOGGER);
+		logger_task();			// one I2C transaction at most: the UI keeps running while a record is saved
+		if( bSettingsDirty ) vSaveSettings();
+		PROF_EXIT(PROF_LOGGER);
+		
+		// Un pulsante per giro: la macchina a stati qui sotto li vede tutti, anche se ne arrivano due di fila.
+		if( button_get(&beButton) ){
+			bBtn = beButton.bCode;
+			ATOMIC_BLOCK(ATOMIC_RESTORESTATE){ wKeyLag = wTicks - beButton.wStamp; }		// wTicks: Timer0 interrupt
+		}
+		
+		PROF_ENTER(PROF_UI);
 		switch( bState ){
 
 /*----------------------------------------------------------__IDLE__------------------------------------*/
 			case STATE_IDLE:
 				switch( bBtn ){
 					case NO_BTN:
-						if( bTimeColonToToggle ){ toggleTimeColon(); bTimeColonToToggle=0; }
-						
 						refreshQuote();
 						bPrintQuotes=1;
 						break;
 						
+					case BTN_B:				// measures --> derived metrics --> trend
+						if( ++bIdleView >= NUMBER_OF_IDLE_VIEWS ) bIdleView = IDLE_VIEW_MEASURES;
+						LCDWriteStringXY_P(0,1, PSTR("                "));
+						invalidateIdleScreen();
+						// no break: B also wakes the backlight up
 					case BTN_A:
-					case BTN_B:
 					case BTN_C:
 					case BTN_A_LONG:
 					case BTN_B_LONG:
@@ -152,12 +213,12 @@ int main(void){
 					case BTN_C_LONG:
 						bState = STATE_MENU;
 						STOP_BACKLIGHT();
-						BACKLIGHT_ON();
-						bBacklightActive=1;
+						BACKLIGHT_ON();			// on while in the menu: no timeout armed
 						bBtn=NO_BTN;
 						break;
 						
-					default:
+					default:				// chords: refreshQuote() only runs with no key pending
+						bBtn=NO_BTN;
 						break;
 				}
 				break;
@@ -166,14 +227,11 @@ int main(void){
 			case STATE_MENU:
 				switch( bBtn ){
 					case NO_BTN:
-						if( bSelectionMenuChanged || bPrintQuotes ){
+						if( bPrintQuotes ){
 							bPrintQuotes=0;
-							bSelectionMenuChanged=0;
-							LCDWriteStringXY(0,0,"-");
-							LCDWriteStringXY(1,0, options[bSelectionMenu]);
-							LCDWriteStringXY(0,1," ");
-							LCDWriteStringXY(1,1, options[bSelectionMenu+1]);
+							screen_invalidate(sfMenu, SCREEN_FIELDS(sfMenu));
 						}
+						screen_render(sfMenu, SCREEN_FIELDS(sfMenu));
 						break;
 					
 					case BTN_A:
@@ -192,31 +250,11 @@ int main(void){
 						break;
 					
 					case BTN_C:
-						switch( bSelectionMenu ){
-							case SEL_DATE:
-								bState = STATE_EDIT_DATE;
-								bBtn = NO_BTN;
-								break;
-								
-							case SEL_TIME:
-								bState = STATE_EDIT_TIME;
-								bBtn = NO_BTN;
-								break;
-								
-							case SEL_HUM_TH_1:
-								bState = STATE_EDIT_HUM_ON_TH;
-								bBtn = NO_BTN;
-								break;
-								
-							case SEL_HUM_TH_2:
-								bState = STATE_EDIT_HUM_AL_TH;
-								bBtn = NO_BTN;
-								break;
-								
-							default:
-								break;
-						}
+						memcpy_P(&miItem, &miMenu[bSelectionMenu], sizeof(menu_item));
+						bState = miItem.bState;
+						pEditing = miItem.pEditor;
 						bPrintQuotes=1;
+						bBtn = NO_BTN;
 						break;
 					
 					case BTN_C_LONG:
@@ -225,350 +263,184 @@ int main(void){
 						LCD_RESET();
 						
 						bSelectionMenu=0;
-						bDateChanged=1;		// Appena rientro in idle stampo le quote
-						bTimeChanged=1;
-						bTempChanged=1;
-						bHumChanged=1;
+						invalidateIdleScreen();		// Appena rientro in idle stampo le quote
 						
-						bBacklightActive=0;
-						BACKLIGHT_OFF();
 						START_BACKLIGHT();
 						bBtn=NO_BTN;
 						break;
 					
 					default:
+						bBtn=NO_BTN;
 						break;
 				}				
 				break;
 			
-/*--------------------------------------------------------------__DATE__-------------------------------*/			
-			case STATE_EDIT_DATE:
+/*--------------------------------------------------------------__EDIT__-------------------------------*/
+			case STATE_EDIT:
 				switch( bBtn ){
 					case NO_BTN:
 						if( bPrintQuotes ){
 							bPrintQuotes=0;
-							LCDClear();
-							tTimeEditing = tTime;
-							sprintf(str, "%02d/%02d/%02d", tTimeEditing.bDay, tTimeEditing.bMonth, tTimeEditing.bYear);
-							LCDWriteStringXY(0,0, "Editing date:");
-							LCDWriteStringXY(3,1, str);
+							editor_open(pEditing);
 							LCD_SET_UNDERLINE_CURSOR;
-							LCD_CURSOR_LEFT_N(7);
 						}
 						break;
 						
 					case BTN_A:
-						switch( bSelection ){
-							case 0:		// day
-								if(++tTimeEditing.bDay > baDays[tTimeEditing.bMonth-1]) tTimeEditing.bDay=1;
-								if(tTimeEditing.bMonth == 2 && !isLeapYear(tTimeEditing.bYear) && tTimeEditing.bDay == 29) tTimeEditing.bDay=1;
-								break;
-							case 1:		// month
-								if(++tTimeEditing.bMonth > 12) tTimeEditing.bMonth=1;
-								checkDay(&tTimeEditing, baDays);
-								break;
-							case 2:		// year
-								tTimeEditing.bYear++;
-								checkDay(&tTimeEditing, baDays);
-								break;
-							default: break;
-						}
-						sprintf(str, "%02d/%02d/%02d", tTimeEditing.bDay, tTimeEditing.bMonth, tTimeEditing.bYear);
-						LCDWriteStringXY(3,1,str);
-						LCD_CURSOR_LEFT_N(7-3*bSelection);
+						editor_step(1);
 						bBtn = NO_BTN;
 						break;
 						
 					case BTN_B:
-						switch( bSelection ){
-							case 0:		// day
-								if(--tTimeEditing.bDay < 1){
-									tTimeEditing.bDay=baDays[tTimeEditing.bMonth-1];
-									if((tTimeEditing.bMonth==2) && (!isLeapYear(tTimeEditing.bYear))) tTimeEditing.bDay=28;
-								}								
-								break;
-							case 1:		// month
-								if(--tTimeEditing.bMonth < 1) tTimeEditing.bMonth=12;
-								checkDay(&tTimeEditing, baDays);
-								break;
-							case 2:		// year
-								if(--tTimeEditing.bYear < 1) tTimeEditing.bYear=99;
-								checkDay(&tTimeEditing, baDays);
-								break;
-							default: break;
-						}
-						sprintf(str, "%02d/%02d/%02d", tTimeEditing.bDay, tTimeEditing.bMonth, tTimeEditing.bYear);
-						LCDWriteStringXY(3,1,str);
-						LCD_CURSOR_LEFT_N(7-3*bSelection);
+						editor_step(-1);
 						bBtn = NO_BTN;
 						break;
 						
 					case BTN_C:
-						if( bSelection<2 ){
-							LCD_CURSOR_RIGHT_N(3);
-							bSelection++;
-						}else{
-							bSelection=0;
-							LCD_CURSOR_LEFT_N(6);
-						}
-						if(checkDay(&tTimeEditing, baDays)){
-							sprintf(str, "%02d/%02d/%02d", tTimeEditing.bDay, tTimeEditing.bMonth, tTimeEditing.bYear);
-							LCDWriteStringXY(3,1,str);
-							LCD_CURSOR_LEFT_N(7-3*bSelection);
-						}
+						editor_next();
 						bBtn = NO_BTN;
 						break;
 						
 					case BTN_C_LONG:
-						bState=STATE_EDIT_DATE_CONFIRM;
-						bBtn=NO_BTN;
+						bState = STATE_EDIT_CONFIRM;
+						bBtn = NO_BTN;
 						bPrintQuotes=1;
 						break;
 						
-					default: break;
+					default:
+						bBtn = NO_BTN;
+						break;
 				}
 				break;
 
-/*----------------------------------------------------------__DATE_confirm__--------------------------------*/
-			case STATE_EDIT_DATE_CONFIRM:
-				vConfirmState();
-				break;
-
-/*--------------------------------------------------------------__TIME__-------------------------------*/
-			case STATE_EDIT_TIME:
-					switch( bBtn ){
-						case NO_BTN:
-							if( bPrintQuotes ){
-								bPrintQuotes=0;
-								LCDClear();
-								tTimeEditing = tTime;
-								sprintf(str, "%02d:%02d:%02d", tTimeEditing.bHour, tTimeEditing.bMin, tTimeEditing.bSec);
-								LCDWriteStringXY(0,0, "Editing time:");
-								LCDWriteStringXY(3,1, str);
-								LCD_SET_UNDERLINE_CURSOR;
-								LCD_CURSOR_LEFT_N(7);
-							}
-							break;
-							
-						case BTN_A:
-							bBtn = NO_BTN;
-							switch ( bSelection ){
-								case 0: // Hours
-									tTimeEditing.bHour++;
-									tTimeEditing.bHour %= 24;
-									break;
-								case 1: // Minutes
-									tTimeEditing.bMin++;
-									tTimeEditing.bMin %= 60;
-									break;
-								case 2: // Seconds
-									tTimeEditing.bSec++;
-									tTimeEditing.bSec %= 60;
-									break;
-								default: break;
-							}
-							
-							sprintf(str, "%02d:%02d:%02d", tTimeEditing.bHour, tTimeEditing.bMin, tTimeEditing.bSec);
-							LCDWriteStringXY(3,1,str);
-							LCD_CURSOR_LEFT_N(7-3*bSelection);
-							break;
-							
-						case BTN_B:
-							bBtn = NO_BTN;
-							switch ( bSelection ){
-								case 0:
-									if(--tTimeEditing.bHour>24) tTimeEditing.bHour=23; // Sarebbe "<0" ma queste variabili non vengono interpretate come con segno
-									break;
-								case 1:
-									if(--tTimeEditing.bMin>60) tTimeEditing.bMin=59;
-									break;
-								case 2:
-									if(--tTimeEditing.bSec>60) tTimeEditing.bSec=59;
-									break;
-								default: break;
-							}
-							sprintf(str, "%02d:%02d:%02d", tTimeEditing.bHour, tTimeEditing.bMin, tTimeEditing.bSec);
-							LCDWriteStringXY(3,1,str);
-							LCD_CURSOR_LEFT_N(7-3*bSelection);
-							break;
-							
-						case BTN_C:
-							if( bSelection<2 ){
-								LCD_CURSOR_RIGHT_N(3);
-								bSelection++;
-							}else{
-								bSelection=0;
-								LCD_CURSOR_LEFT_N(6);
-							}
-							bBtn = NO_BTN;
-							break;
-							
-						case BTN_C_LONG:
-							bState=STATE_EDIT_TIME_CONFIRM;
-							bBtn=NO_BTN;
-							bPrintQuotes=1;
-							break;
-							
-						default:
-							break;
-					}
-				
-				break;
-
-/*--------------------------------------------------------------__TIME_confirm__------------------------------*/
-			case STATE_EDIT_TIME_CONFIRM:
+/*--------------------------------------------------------------__EDIT_confirm__------------------------------*/
+			case STATE_EDIT_CONFIRM:
 				vConfirmState();
 				break;
 				
-/*-------------------------------------------------------------------__HUMIDITY_ON__---------------------------*/
-			case STATE_EDIT_HUM_ON_TH:
-				
+/*--------------------------------------------------------------__DIAGNOSTICS__-------------------------------*/
+			case STATE_DIAGNOSTICS:
 				switch( bBtn ){
 					case NO_BTN:
 						if( bPrintQuotes ){
 							bPrintQuotes=0;
-							LCDClear();
-							bHumOnThresholdEditing = bHumOnThreshold;
-							sprintf(str, "p:%02dRH,  c:%02d RH", bHumOnThreshold, bHumOnThresholdEditing);
-							LCDWriteStringXY(0,0, "Edit Hum-On TH:");
-							LCDWriteStringXY(0,1, str);
-							//LCDWriteString("%");
-							LCD_SET_UNDERLINE_CURSOR;
-							LCD_CURSOR_LEFT_N(4);
+							printDiagnostics();
 						}
 						break;
 						
 					case BTN_A:
-						if( ++bHumOnThresholdEditing > 99 ) bHumOnThresholdEditing = 0;
-						sprintf(str, "%02d", bHumOnThresholdEditing);
-						LCDWriteStringXY(11,1, str);
-						LCD_CURSOR_LEFT_N(1);
-						bBtn=0;
+						if( ++bDiagPage >= NUMBER_OF_DIAG_PAGES ) bDiagPage=0;
+						bPrintQuotes=1;
+						bBtn=NO_BTN;
 						break;
 						
 					case BTN_B:
-						if( --bHumOnThresholdEditing > 100 ) bHumOnThresholdEditing=99;
-						sprintf(str, "%02d", bHumOnThresholdEditing);
-						LCDWriteStringXY(11,1, str);
-						LCD_CURSOR_LEFT_N(1);
-						bBtn=0;
+						if( bDiagPage>0 ) bDiagPage--;
+						else bDiagPage=(NUMBER_OF_DIAG_PAGES-1);
+						bPrintQuotes=1;
+						bBtn=NO_BTN;
+						break;
+						
+					case BTN_C:				// dump everything on the serial port, then refresh the page
+						mem_dump();
+						dumpCounters();
+#ifdef PROFILER_ENABLED
+						prof_dump();
+#endif
+						bPrintQuotes=1;
+						bBtn=NO_BTN;
 						break;
 						
 					case BTN_C_LONG:
-						bState = STATE_EDIT_HUM_ON_TH_CONFIRM;
-						sprintf(str, "");
+						bState = STATE_MENU;
+						bDiagPage = 0;			// the next visit starts from the first page
+						LCD_RESET();
 						bPrintQuotes=1;
-						bBtn=0;
+						bBtn=NO_BTN;
+						break;
+						
+					default:
+						bBtn=NO_BTN;
 						break;
-					default: break;
 				}
-				
 				break;
 				
-
-/*--------------------------------------------------------------__HUMIDITY_ON_confirm__-------------------------*/
-			case STATE_EDIT_HUM_ON_TH_CONFIRM:
-				vConfirmState();
-				break;
-
-/*-------------------------------------------------------------------__HUMIDITY_AL__---------------------------*/
-			case STATE_EDIT_HUM_AL_TH:
-				
+/*--------------------------------------------------------------__STATISTICS__--------------------------------*/
+			case STATE_STATS:
 				switch( bBtn ){
 					case NO_BTN:
 						if( bPrintQuotes ){
 							bPrintQuotes=0;
 							LCDClear();
-							bHumAlarmThresholdEditing = bHumAlarmThreshold;
-							sprintf(str, "p:%02dRH,  c:%02d RH", bHumAlarmThreshold, bHumAlarmThresholdEditing);
-							LCDWriteStringXY(0,0, "Edit Hum-Al TH:");
-							LCDWriteStringXY(0,1, str);
-							LCD_SET_UNDERLINE_CURSOR;
-							LCD_CURSOR_LEFT_N(4);
+							bStatsChanged=1;
 						}
+						if( bStatsDetail ) screen_render(sfStatsDetail, SCREEN_FIELDS(sfStatsDetail));
+						else screen_render(sfStats, SCREEN_FIELDS(sfStats));		// live: redrawn at every sample
+						break;
+						
+					case BTN_C:				// mean/min/max <--> spread and when min/max were reached
+						bStatsDetail = !bStatsDetail;
+						bStatsChanged=1;
+						bBtn=NO_BTN;
 						break;
 						
 					case BTN_A:
-						if( ++bHumAlarmThresholdEditing > 99 ) bHumAlarmThresholdEditing = 0;
-						sprintf(str, "%02d", bHumAlarmThresholdEditing);
-						LCDWriteStringXY(11,1, str);
-						LCD_CURSOR_LEFT_N(1);
-						bBtn=0;
+						if( ++bStatsPage >= NUMBER_OF_STATS_PAGES ) bStatsPage=0;
+						bStatsChanged=1;
+						bBtn=NO_BTN;
 						break;
 						
 					case BTN_B:
-						if( --bHumAlarmThresholdEditing > 100 ) bHumAlarmThresholdEditing=99;
-						sprintf(str, "%02d", bHumAlarmThresholdEditing);
-						LCDWriteStringXY(11,1, str);
-						LCD_CURSOR_LEFT_N(1);
-						bBtn=0;
+						if( bStatsPage>0 ) bStatsPage--;
+						else bStatsPage=(NUMBER_OF_STATS_PAGES-1);
+						bStatsChanged=1;
+						bBtn=NO_BTN;
 						break;
 						
 					case BTN_C_LONG:
-						bState = STATE_EDIT_HUM_AL_TH_CONFIRM;
-						
+						bState = STATE_MENU;
+						LCD_RESET();
 						bPrintQuotes=1;
-						bBtn=0;
+						bBtn=NO_BTN;
+						break;
+						
+					default:				// keys without a meaning here: the page keeps refreshing
+						bBtn=NO_BTN;
 						break;
-					default: break;
 				}
-				
-				break;
-				
-
-/*--------------------------------------------------------------__HUMIDITY_AL_confirm__-------------------------*/
-			case STATE_EDIT_HUM_AL_TH_CONFIRM:
-				vConfirmState();
-				break;
-				
-/*---------------------------------------------------------------__LOGGING_DATA__-------------------------------*/
-			case STATE_LOG_DATA:
-				if(bTodayLogs == 0){
-					EEPROM_writeByte(lLastIndex++, tTime.bDay);
-					EEPROM_writeByte(lLastIndex++, tTime.bMonth);
-					EEPROM_writeByte(lLastIndex++, tTime.bYear);
-				}
-				EEPROM_writeData(lLastIndex, (byte*)&fHumidity, SIZE_OF_LOG);
-				lLastIndex += SIZE_OF_LOG;
-				EEPROM_writeData(lLastIndex, (byte*)&fTemperature, SIZE_OF_LOG);
-				lLastIndex += SIZE_OF_LOG;
-				
-				if(++bTodayLogs >= NUMBER_OF_LOGS_PER_DAY){
-					bTodayLogs=0;
-					wLoggedDays++;
-					
-					// Ho raggiunto il numero massimo di log giornalieri: aggiorno i valori della data e LoggedDays nella EEPROM.
-					EEPROM_writeByte(EEPROM_DAY_ADD, tTime.bDay);
-					EEPROM_writeByte(EEPROM_MONTH_ADD, tTime.bMonth);
-					EEPROM_writeByte(EEPROM_YEAR_ADD, tTime.bYear);
-					
-					EEPROM_writeData(EEPROM_LOGGED_DAYS_ADD, (byte*)&wLoggedDays, sizeof(word));
-				}
-				
-				// Aggiorno todayLogs, lastIndex e ora ad ogni campionamento.
-				EEPROM_writeByte(EEPROM_TODAY_LOGS_ADD, bTodayLogs);
-				EEPROM_writeData(EEPROM_LAST_INDEX_ADD, (byte*)&lLastIndex, sizeof(long));
-				
-				EEPROM_writeByte(EEPROM_MIN_ADD, tTime.bMin);
-				EEPROM_writeByte(EEPROM_HOUR_ADD, tTime.bHour);
-				
-				//LCDClear();
-				//sprintf(str, "%d", bState);
-				//LCDWriteStringXY(0,0,str);
-				
-				bState = bStateOld;
-				
-				//sprintf(str, "%d", bState);
-				//LCDWriteStringXY(0,1,str);
-				//
-				//_delay_ms(200);
-				
 				break;
 				
 /*------------------------------------------------------------------------------------------------------------*/
 			default:
 				break;
 		}
+		PROF_EXIT(PROF_UI);
+		
+		LCDFlush();				// whatever this pass has drawn: only the changed cells are queued
+		LCDTask();				// one byte to the LCD, if it is not busy: the loop never waits for it
+		
+		// Niente da fare fino al prossimo interrupt: dormo (i timer e l'ADC continuano a girare).
+		cli();
+		if( isMainLoopIdle() ){
+#if RTC_BACKEND == RTC_TIMER2_ASYNC
+			// Power-save ferma il clock di I/O: solo se non sto scandendo i tasti e l'ADC e' fermo.
+			if(( TIMSK0 & (1<<OCIE0B) )||( ADCSRA & (1<<ADSC) )){
+				set_sleep_mode(SLEEP_MODE_IDLE);
+			}else{
+				set_sleep_mode(SLEEP_MODE_PWR_SAVE);
+				OCR2B = 0;							// the asynchronous timer needs a TOSC cycle after the
+				while( ASSR & (1<<OCR2BUB) );		// wake-up before power-save can be entered again
+			}
+#endif
+			sleep_enable();
+			sei();
+			sleep_cpu();			// sei() delays interrupts by one instruction: no wake-up can be lost in between
+			sleep_disable();
+			lWakeUps++;
+		}else{
+			sei();
+			lWorkPasses++;
+		}
 	}	
 }
 
@@ -582,200 +454,91 @@ int main(void){
 
 /****************************  RealTimeClock Interrupt ******************************/
 ISR(TIMER0_COMPB_vect){
-	if(bPriLev<PRI_TIMER0)	return;
-	byte bOldPriLev = bPriLev;
-	bPriLev=PRI_TIMER0;
-	
+	PROF_ENTER(PROF_TIMER0);
+	PROF_SAMPLE(PROF_TIMER0_LATENCY, (uint16_t)TCNT0 << 7);	// TCNT0 counts F_CPU/1024 = 128 Timer1 ticks
 	
 /*	*************** FILTERS **************	*/
-	bPort = BUTTON_PINS;
-	bBtnAPressed = bPort & BIT2;		// UP
-	bBtnBPressed = bPort & BIT4;		// DOWN
-	bBtnCPressed = bPort & BIT3;		// MENU
-	// bBtnXPressed=0  -->button X pressed! connected to ground
-	
-	if(!bBtnCPressed&&(!bInhibite)){ //btnC is pressed
-		cButtonIntegrator.wC++;
-		if(cButtonIntegrator.wC>LONG_PRESSION_TIME){ bInhibite=1; }  // inhibites the btnC counter whenever entered in the menu
-	}
-	else{
-		if(bBtnCPressed!=0){	//btnC is not pressed <--  qui la furbata! disinibisco il pulsante C solo nel momento in 
-			bInhibite=0;		// cui questo viene rilasciato; se entro nel menu e il pulsante  ancora premuto,
-		}						// bInhibite resta a 1 e quindi wC a 0; questo finch mantengo premuto C.
-								// Quando lo rilascio lo disinibisco, riattivandolo.
-		
-		if(cButtonIntegrator.wC<DEBOUNCE_TIME){
-			cButtonIntegrator.wC=0;
-		}else if((cButtonIntegrator.wC>DEBOUNCE_TIME)&&(cButtonIntegrator.wC<LONG_PRESSION_TIME)){
-			cButtonIntegrator.wC=0;
-			bBtn = BTN_C;
-		}else if(cButtonIntegrator.wC>LONG_PRESSION_TIME){
-			cButtonIntegrator.wC=0;
-			bBtn = BTN_C_LONG;
-		}
-	}
-	
-	
-	if(!bBtnAPressed){ 
-		if(++cButtonIntegrator.wA>REPEATED_PRESSION_TIME){
-			bBtn = BTN_A;
-			cButtonIntegrator.wA=0;
-		}
-	}else{
-		if(cButtonIntegrator.wA<DEBOUNCE_TIME){ cButtonIntegrator.wA=0; }
-		else{
-			bBtn = BTN_A;
-			cButtonIntegrator.wA=0;
-		}
-	}
+	bPort = ~BUTTON_PINS & BUTTON_MASK;		// bit=1 --> button pressed (connected to ground)
+	vScanKeys(bPort);
 	
 	
-	if(!bBtnBPressed){
-		if(++cButtonIntegrator.wB>REPEATED_PRESSION_TIME){
-			bBtn = BTN_B;
-			cButtonIntegrator.wB=0;
-		}
-	}else{
-		if(cButtonIntegrator.wB<DEBOUNCE_TIME){ cButtonIntegrator.wB=0; }
-		else{
-			bBtn = BTN_B;
-			cButtonIntegrator.wB=0;
-		}
-	}
+/* ******************************* RTC ******************************** */	
 	
+	wTicks++;
 	
-	if((!bBtnAPressed)&&(!bBtnBPressed)){ cButtonIntegrator.wAB++; }
+#if RTC_BACKEND == RTC_TIMER0
+	bTimeSeq++;				// odd: the RTC is being updated
+	if(wRtcMilli<99) wRtcMilli++;
 	else{
-		if(cButtonIntegrator.wAB<DEBOUNCE_TIME){ cButtonIntegrator.wAB=0; }
-		else{
-			bBtn = BTN_AB;
-			cButtonIntegrator.wAB=0;
-		}
+		wRtcMilli=0;
+		vRtcSecond();
 	}
-	
-	
-/* ******************************* RTC ******************************** */	
-	
-	if(tTime.wMilli<99) tTime.wMilli++;
-	else{
-		tTime.wMilli=0;
-		if( tTime.bSec<59 ){
-			tTime.bSec++;
-			bTimeColonToToggle=1;	// time colon is flashing at 1 Hz
-			//START_ADC();			//testing: adc int every 1 sec
-		}else{
-			tTime.bSec=0;
-			if( tTime.bMin<59 ){
-				tTime.bMin++;
-			}else{
-				tTime.bMin=0;
-				if( tTime.bHour<23 ) tTime.bHour++;
-				else {
-					tTime.bHour=0;
-					if(tTime.bDay<(baDays[tTime.bMonth-1])){
-						tTime.bDay++;
-						if(tTime.bDay==29 && tTime.bMonth==2 && (!isLeapYear(tTime.bYear))){
-							tTime.bDay=1;
-							tTime.bMonth=3;
-						}
-					}else{
-						tTime.bDay=1;
-						if(tTime.bMonth<12) tTime.bMonth++;
-						else{
-							tTime.bMonth=1;
-							tTime.bYear++;  // non c' bisogno di impostare la data e il giorno, viene eseguito
-											// automaticamente dall'ins, cio dai millisecondi.
-						} // month
-					} // day
-					bDateChanged=1;
-				}	// hour				
-			}  // minute
-			bTimeChanged=1;		// refresh quote every min for the minutes changing
-			
-			if(isTimeToSample(&tTime)){		// if it is time to log data into EEPROM
-				START_ADC();					// start ADC
-			}
-			
-		}	// second
-	} // millisecond
-	
-	bPriLev = bOldPriLev;
+	bTimeSeq++;
+#else
+	// Nessun tasto premuto: fermo la scansione e torno ad aspettare un pin change (e il power-save).
+	if( !bPort && !bKeysDebounced ){
+		TIMSK0 &= ~(1<<OCIE0B);
+		PCIFR = (1<<PCIF2);
+		PCICR |= (1<<PCIE2);
+	}
+#endif
+	PROF_EXIT(PROF_TIMER0);
 }
 
 
-/*************************** Timer2 Interrupt / Backlight *****************************/
-ISR(TIMER2_COMPB_vect){			// Timer2 : 8 bit
-	if(bPriLev<PRI_TIMER2) return;
-	byte bOldPriLev = bPriLev;
-	
-	if(bBacklightActive) return;
-	
-	if(wBacklightCounter<BACKLIGHT_TIME){ wBacklightCounter++; return; }
-	wBacklightCounter=0;
-	STOP_BACKLIGHT();
-	
-	bPriLev = bOldPriLev;
+#if RTC_BACKEND == RTC_TIMER2_ASYNC
+/********************** Timer2 Interrupt / Asynchronous RTC ***************************/
+ISR(TIMER2_OVF_vect){			// 32768 Hz / 128 / 256: once per second, also in power-save
+	PROF_ENTER(PROF_TIMER2);
+	bTimeSeq++;
+	vRtcSecond();
+	bTimeSeq++;
+	PROF_EXIT(PROF_TIMER2);
+}
+
+
+/********************** Pin Change Interrupt / Buttons ********************************/
+ISR(PCINT2_vect){
+	PROF_ENTER(PROF_PCINT);
+	PCICR &= ~(1<<PCIE2);		// the Timer0 scan takes over the debouncing until every key is released
+	TIFR0 = (1<<OCF0B);
+	TIMSK0 |= (1<<OCIE0B);
+	PROF_EXIT(PROF_PCINT);
 }
+#endif
 
 
 /****************************  ADC Interrupt ******************************/
 ISR(ADC_vect){
-	if(bPriLev<PRI_ADC){
-		ADCSRA |= 1<<ADIF;
-		return;
-	}
-	
-	sreg = MCUSR;	// float operations: avoid interrupts to make operations reliable
-	cli();
-	
-	byte bOldPriLev = bPriLev;
+	adc_channel *acCh;
+	int16_t iValue;
 	
-	
-	if(bFirstConversion){
-		bFirstConversion=0;
-		ADCSRA |= 1<<ADSC;		// imposto l'adc perch faccia la seconda campionatura
-		return;					// mentre la prima viene scartata
+	PROF_ENTER(PROF_ADC);
+	if(bDiscard){
+		bDiscard--;
+		ADCSRA |= 1<<ADSC;		// imposto l'adc perche' faccia un'altra campionatura
+		PROF_EXIT(PROF_ADC);
+		return;					// mentre questa viene scartata
 	}
 	
-	
-	float fTemperatureOld;
-	float fHumidityOld;
-	
-	switch(bChannel){
-		case ADC_TEMPERATURE_CHANNEL:
-			fTemperatureOld = fTemperature;
-			fTemperature = getTemperature();
-			if(fTemperatureOld != fTemperature) bTempChanged=1;
-			
-			ADCSRA |= 1<<ADSC;
-			
-			ADC_SET_HUMIDITY_CHANNEL();
-			bChannel = ADC_HUMIDITY_CHANNEL;
-			bFirstConversion=1;
-			break;
-			
-		case ADC_HUMIDITY_CHANNEL:
-			fHumidityOld = fHumidity;
-			fHumidity = getHumidity(fTemperature);
-			if(fHumidityOld != fHumidity) bHumChanged=1;
-			
-			ADC_SET_TEMPERATURE_CHANNEL();
-			bChannel = ADC_TEMPERATURE_CHANNEL;
-			bFirstConversion=1;
-			
-			bStateOld = bState;			// cambio lo stato qui e non all'interno di ISR(TIMER_0) perch  dopo questa
-			bState = STATE_LOG_DATA;	// routine che sono pronti i campioni.
-			
-			break;
-		
-		default: break;
-		
+	acCh = &acChannels[bChannel];
+	iValue = acCh->fConvert(ADC, iaChannelValue[acCh->bRef]);
+	if(iaChannelValue[bChannel] != iValue){
+		iaChannelValue[bChannel] = iValue;
+		if(bChannel == ADC_CH_TEMPERATURE) bTempChanged=1;
+		if(bChannel == ADC_CH_HUMIDITY) bHumChanged=1;
 	}
 	
-	sei();
-	MCUSR=sreg;
+	if(selectNextChannel(bChannel+1)){		// more channels to convert in this pass
+		ADCSRA |= 1<<ADSC;
+		PROF_EXIT(PROF_ADC);
+		return;
+	}
 	
-	bPriLev = bOldPriLev;
+	/* Scan completed: all the enabled channels have a fresh value, the rest is done in vOnSampleReady(). */
+	selectNextChannel(0);			// ready for the next START_ADC()
+	event_post(EV_SAMPLE_READY, 0);
+	PROF_EXIT(PROF_ADC);
 }
 
 
@@ -793,7 +556,8 @@ void init_EEPROM(void){
 		EEPROM_writeByte(EEPROM_HOUR_ADD, 0);
 		
 		
-		EEPROM_writeByte(EEPROM_TODAY_LOGS_ADD, 0x0);
+		word todayNum = 0;
+		EEPROM_writeData(EEPROM_TODAY_LOGS_ADD, (uint8_t*)&todayNum, sizeof(word));
 		
 		word daysNum = 2;
 		EEPROM_writeData(EEPROM_LOGGED_DAYS_ADD, (uint8_t*)&daysNum, sizeof(word));
@@ -810,8 +574,7 @@ void init_EEPROM(void){
 void init_ADC(void){
 	ADCSRA = ADC_PRESCALER_VALUE;					// ADC Prescaler = Fck/128
 	ADCSRA |= (1<<ADIE);							// enabling ADC Interrupt
-	ADC_SET_TEMPERATURE_CHANNEL();					// let's start with temperature
-	bChannel = ADC_TEMPERATURE_CHANNEL;
+	selectNextChannel(0);							// first enabled channel of the table
 }
 
 void init_LCD(uint8_t bPowerUp){
@@ -826,14 +589,34 @@ void init_TIMER0_B(void){
 	TCCR0B |= (1<<CS02)|(1<<CS00);			// clock: F_CPU / 1024
 	TCCR0A |= (1<<WGM01);					// Clear Timer on Compare
 	TIMSK0 |= (1<<OCIE0B);					// Output compare match interrupt enable
-	OCR0A = 156;							// Interrupt every 10ms
+	OCR0A = TIMER0_TOP;						// Interrupt every 10ms
+}
+
+
+void init_TIMER2_ASYNC(void){
+	TIMSK2 = 0;
+	ASSR |= (1<<AS2);						// clocked by the 32.768 kHz crystal on TOSC1/TOSC2
+	TCNT2 = 0;
+	TCCR2A = 0;								// normal mode
+	TCCR2B = (1<<CS22)|(1<<CS20);			// 32768 / 128: overflow once per second
+	while( ASSR & ((1<<TCN2UB)|(1<<TCR2AUB)|(1<<TCR2BUB)) );	// asynchronous registers updated
+	TIFR2 = (1<<TOV2)|(1<<OCF2A)|(1<<OCF2B);
+	TIMSK2 = (1<<TOIE2);
+}
+
+
+/// Periodic jobs of the RTC tick, started once the settings are loaded.
+void init_SOFT_TIMERS(void){
+	timer_start(&tmColon, 1, 1, vColonExpired);
+	timer_start(&tmSample, SAMPLE_PERIOD_S, SAMPLE_PERIOD_S, vSampleExpired);
+	armLogSilence();
 }
 
 
-void init_TIMER2_B(void){
-	TCCR2A |= (1<<WGM21);
-	TIMSK2 |= (1<<OCIE2B);
-	OCR2A = 156;
+void init_BUTTONS_PCINT(void){
+	PCMSK2 |= BUTTON_A+BUTTON_B+BUTTON_C;	// PCINT16..23 are PD0..7: same bits as BUTTON_PORT
+	PCIFR = (1<<PCIF2);
+	PCICR |= (1<<PCIE2);
 }
 
 
@@ -852,7 +635,18 @@ void _init_AVR(void){
 	init_ADC();
 	init_LCD(1);			// Initialize the LCD while powering it up.
 	init_TIMER0_B();
-	init_TIMER2_B();
+	init_SOFT_TIMERS();
+#if RTC_BACKEND == RTC_TIMER0
+	set_sleep_mode(SLEEP_MODE_IDLE);			// Timer2 is not used
+#else
+	TIMSK0 &= ~(1<<OCIE0B);					// buttons are scanned only after a pin change
+	init_TIMER2_ASYNC();
+	init_BUTTONS_PCINT();
+#endif
+	uart_init();
+#ifdef PROFILER_ENABLED
+	prof_init();
+#endif
 	sei();						// SEt Interrupts: let's start!
 }
 
@@ -868,38 +662,62 @@ void init_CTRL_Data_fromEEPROM(void){
 	tEE.bSec = 0;
 	tEE.wMilli = 0;
 	
-	if(isValidTimeDate(&tEE)){
-		tTime = tEE;
-	}else{
-		tTime.bDay = 4;
-		tTime.bMonth = 5;
-		tTime.bYear = 12;
-		tTime.wMilli=0;
-		tTime.bSec=0;
-		tTime.bMin=0;
-		tTime.bHour=0;
+	if(!isValidTimeDate(&tEE)){
+		tEE.bDay = 4;
+		tEE.bMonth = 5;
+		tEE.bYear = 12;
+		tEE.bMin=0;
+		tEE.bHour=0;
 		
-		EEPROM_writeByte(EEPROM_DAY_ADD, tTime.bDay);
-		EEPROM_writeByte(EEPROM_MONTH_ADD, tTime.bMonth);
-		EEPROM_writeByte(EEPROM_YEAR_ADD, tTime.bYear);
-		EEPROM_writeByte(EEPROM_MIN_ADD, tTime.bMin);
-		EEPROM_writeByte(EEPROM_HOUR_ADD, tTime.bHour);
+		EEPROM_writeByte(EEPROM_DAY_ADD, tEE.bDay);
+		EEPROM_writeByte(EEPROM_MONTH_ADD, tEE.bMonth);
+		EEPROM_writeByte(EEPROM_YEAR_ADD, tEE.bYear);
+		EEPROM_writeByte(EEPROM_MIN_ADD, tEE.bMin);
+		EEPROM_writeByte(EEPROM_HOUR_ADD, tEE.bHour);
 	}
+	setTime(&tEE);
 	
-	byte todayLogsTemp;
+	byte j;
+	word todayLogsTemp;
 	word daysLoggedTemp;
 	long lastIndexTemp;
+	word logIntervalTemp;
+	byte logModeTemp;
 	
-	todayLogsTemp = EEPROM_readByte(EEPROM_TODAY_LOGS_ADD);
+	EEPROM_readData(EEPROM_TODAY_LOGS_ADD, (byte*)&todayLogsTemp, sizeof(word));
 	EEPROM_readData(EEPROM_LOGGED_DAYS_ADD, (byte*)&daysLoggedTemp, sizeof(word));
 	EEPROM_readData(EEPROM_LAST_INDEX_ADD, (byte*)&lastIndexTemp, sizeof(long));
+	EEPROM_readData(EEPROM_LOG_INTERVAL_ADD, (byte*)&logIntervalTemp, sizeof(word));
+	logModeTemp = EEPROM_readByte(EEPROM_LOG_MODE_ADD);
+	
+	if( todayLogsTemp > MINS_PER_DAY ){
+		wTodayLogs = 0;
+		EEPROM_writeData(EEPROM_TODAY_LOGS_ADD, (byte*)&wTodayLogs, sizeof(word));
+	}else{
+		wTodayLogs = todayLogsTemp;
+	}
+	
+	if( !isValidLogInterval(logIntervalTemp) ){
+		wLogInterval = LOG_INTERVAL_DEFAULT;
+		EEPROM_writeData(EEPROM_LOG_INTERVAL_ADD, (byte*)&wLogInterval, sizeof(word));
+	}else{
+		wLogInterval = logIntervalTemp;
+	}
 	
-	if(( todayLogsTemp < 0 )||( todayLogsTemp > NUMBER_OF_LOGS_PER_DAY )){
-		bTodayLogs = 0;
-		EEPROM_writeByte(EEPROM_TODAY_LOGS_ADD, bTodayLogs);
+	if( logModeTemp > LOG_MODE_DEADBAND ){
+		bLogMode = LOG_MODE_PERIODIC;
+		EEPROM_writeByte(EEPROM_LOG_MODE_ADD, bLogMode);
 	}else{
-		bTodayLogs = todayLogsTemp;
+		bLogMode = logModeTemp;
 	}
+	bLogDay = tEE.bDay;
+	
+	for(j=0; j<ADC_NUMBER_OF_CHANNELS; j++) stats_reset(&rsaInterval[j]);
+	stats_reset(&rsDewInterval);
+	stats_reset(&rsHumToday);
+	stats_reset(&rsTempToday);
+	stats_reset(&rsHumYesterday);
+	stats_reset(&rsTempYesterday);
 	
 	if(( daysLoggedTemp < 0 )){
 		wLoggedDays = 0;
@@ -908,11 +726,11 @@ void init_CTRL_Data_fromEEPROM(void){
 		wLoggedDays = daysLoggedTemp;
 	}
 	
-	if(( lastIndexTemp < EEPROM_LAST_INDEX_ADD+4 )||( lastIndexTemp >= EEPROM_SIZE_B )){
+	if(( lastIndexTemp < EEPROM_DATA_START_ADD )||( lastIndexTemp >= EEPROM_SIZE_B )){
 		#ifdef TESTING
-			lLastIndex = EEPROM_LAST_INDEX_ADD+5;
+			lLastIndex = EEPROM_DATA_START_ADD+1;
 		#else
-			lLastIndex = EEPROM_LAST_INDEX_ADD+4;
+			lLastIndex = EEPROM_DATA_START_ADD;
 		#endif
 		
 		EEPROM_writeData(EEPROM_LAST_INDEX_ADD, (byte*)&lLastIndex, sizeof(long));
@@ -923,88 +741,328 @@ void init_CTRL_Data_fromEEPROM(void){
 	return;
 }
 
-float getTemperature(){
-	float temp;
-	float fVadc1;
+/// LM35: 10 mV/degC, result in tenths of degree.
+int16_t getTemperature(word adc, int16_t ref){
+	return ((uint32_t)adc * VREF_MV + 512) >> 10;		// mV == tenths of degree
+}
+
+/// HIH-4030, compensated with \a temperature (tenths of degree); result in tenths of %RH.
+int16_t getHumidity(word adc, int16_t temperature){
+	int32_t lRatio;
+	int32_t lComp;
+	
+	// RH = (Vout/VREF - 0.16) / 0.0062,  RHcomp = RH / (1.0546 - 0.00216*T)   (HIH-4030 datasheet)
+	lRatio = ((int32_t)adc * 10000 + 512) >> 10;			// Vout/VREF * 10^4
+	lComp = 10546 - ((int32_t)temperature * 216) / 100;		// compensation * 10^4
+	
+	return ((lRatio - 1600) * 100000) / (62 * lComp);
+}
+
+/// Supply voltage in mV, from the bandgap measured against AREF (tied to the supply).
+int16_t getSupplyVoltage(word adc, int16_t ref){
+	if(adc == 0) return 0;
+	return ((uint32_t)BANDGAP_MV * 1024 + (adc>>1)) / adc;
+}
+
+/**
+ * \brief Selects the first enabled channel at or after \a from.
+ *
+ * Programs ADMUX and the number of conversions to discard; returns 0 when
+ * there are no more enabled channels (the scan pass is over).
+ */
+uint8_t selectNextChannel(byte from){
+	byte j;
+	
+	for(j=from; j<ADC_NUMBER_OF_CHANNELS; j++){
+		if(acChannels[j].bEnabled){
+			bChannel = j;
+			ADMUX = acChannels[j].bMux;
+			bDiscard = acChannels[j].bDiscard;
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/// Bit j set when acChannels[j] is enabled (layout of the log records).
+byte getChannelMask(void){
+	byte j, bMask=0;
 	
-	fVadc1 = ADC * VREF/1024;
-	temp = fVadc1 / TEMP_SENSOR_GAIN;
+	for(j=0; j<ADC_NUMBER_OF_CHANNELS; j++){
+		if(acChannels[j].bEnabled) bMask |= 1<<j;
+	}
+	return bMask;
+}
+
+void dataLog(time_date *time, void * humidity, void * temperature){
+	START_ADC();
 	
-	return temp;
 }
 
-float getHumidity(float temperature){
-	float fVadc0;
-	float fRH;
-	float fRH_comp;
+
+/**
+ * \brief Runs the handler of an event taken from the queue.
+ *
+ * Handlers run to completion in the main loop, with interrupts enabled.
+ */
+void vDispatch(event *ev){
+	switch(ev->bType){
+		case EV_TICK:
+			if(bState == STATE_IDLE) toggleTimeColon();
+			break;
+		case EV_SAMPLE_READY:
+			vOnSampleReady();
+			break;
+		case EV_LOG_DUE:
+			bLogPending=1;			// the record waits for the scan just started
+			break;
+		case EV_NEW_DAY:
+			vNewDay();
+			break;
+		default: break;
+	}
+}
+
+/// Midnight, or a date set from the menu: the daily statistics roll over.
+void vNewDay(void){
+	rsHumYesterday = rsHumToday;	// a new day begins: no EEPROM reads to show the last one
+	rsTempYesterday = rsTempToday;
+	stats_reset(&rsHumToday);
+	stats_reset(&rsTempToday);
+	bStatsChanged=1;
+}
+
+/**
+ * \brief Statistics, derived metrics and log trigger of a completed ADC scan.
+ *
+ * The ADC stays idle until the next START_ADC(), at least a second away, so
+ * iaChannelValue[] is stable here.
+ */
+void vOnSampleReady(void){
+	byte j;
+	int16_t iDewPointOld = iDewPoint;
+	word wAbsHumidityOld = wAbsHumidity;
+	time_date tNow;
+	
+	getTime(&tNow);
+	for(j=0; j<ADC_NUMBER_OF_CHANNELS; j++){
+		if(acChannels[j].bEnabled) stats_update(&rsaInterval[j], iaChannelValue[j], tNow.bHour, tNow.bMin);
+	}
+	stats_update(&rsTempToday, iaChannelValue[ADC_CH_TEMPERATURE], tNow.bHour, tNow.bMin);
+	stats_update(&rsHumToday, iaChannelValue[ADC_CH_HUMIDITY], tNow.bHour, tNow.bMin);
+	if(!(bStatsPage & STATS_PAGE_YESTERDAY)) bStatsChanged=1;
+	trend_push(&thTemp, iaChannelValue[ADC_CH_TEMPERATURE]);
+	trend_push(&thHum, iaChannelValue[ADC_CH_HUMIDITY]);
+	bTrendChanged=1;
+	
+	// Derived metrics: table driven, bounded cost (no log/exp).
+	iDewPoint = derived_dewPoint(iaChannelValue[ADC_CH_TEMPERATURE], iaChannelValue[ADC_CH_HUMIDITY]);
+	wAbsHumidity = derived_absHumidity(iaChannelValue[ADC_CH_TEMPERATURE], iaChannelValue[ADC_CH_HUMIDITY]);
+	if((iDewPointOld != iDewPoint)||(wAbsHumidityOld != wAbsHumidity)) bDerivedChanged=1;
+	stats_update(&rsDewInterval, iDewPoint, tNow.bHour, tNow.bMin);
 	
-	fVadc0 = ADC * VREF/1024;
-	fRH = (fVadc0/VREF - 0.16) / 0.0062;					// Formulas given by HIH-4030 datasheet	
-	fRH_comp = fRH/(1.0546-0.00216*temperature);			//
+	if(!bLastLoggedSet){		// the first scan is the reference: no record for leaving a deadband around 0
+		for(j=0; j<ADC_NUMBER_OF_CHANNELS; j++) iaLastLogged[j] = iaChannelValue[j];
+		bLastLoggedSet=1;
+	}
+	if(bLogMode == LOG_MODE_DEADBAND && isOutsideDeadband()) bLogPending=1;
 	
-	return fRH_comp;
+	// Coda piena: il record resta in attesa e riprova al prossimo campionamento, le statistiche continuano ad accumularsi.
+	if(bLogPending && logger_free() >= LOG_RECORD_JOBS){
+		bLogPending=0;
+		armLogSilence();
+		for(j=0; j<ADC_NUMBER_OF_CHANNELS; j++) iaLastLogged[j] = iaChannelValue[j];
+		vLogData();
+	}
 }
 
-void refreshQuote(){
-	if(bDateChanged){
-		bDateChanged=0;
-		sprintf(str, "%02d/%02d/%02d,", tTime.bDay, tTime.bMonth, tTime.bYear);
-		LCDWriteStringXY(0,0,str);
+/**
+ * \brief Builds a log record (and the daily header when needed) and queues it.
+ *
+ * Runs as a job of the scheduler: the UI state is left untouched, so a log
+ * falling in the middle of an edit does not disturb it. The bytes are written
+ * in background by logger_task(): the record first, then the status block
+ * pointing past it, so a reset in between loses the record but never corrupts
+ * the log area. The caller checks that LOG_RECORD_JOBS slots of the queue are free.
+ */
+void vLogData(void){
+	byte baRecord[LOG_RECORD_MAX_SIZE];
+	byte baStatus[EEPROM_STATUS_SIZE];
+	channel_log clLog;
+	byte bSize=0;
+	byte j;
+	time_date tNow;
+	
+	getTime(&tNow);			// header, timestamp and day change all from the same instant
+	
+	// Intervallo e modo possono cambiare durante il giorno: il giorno si chiude al primo log con data nuova.
+	if(( wTodayLogs != 0 )&&( tNow.bDay != bLogDay )){
+		wTodayLogs=0;
+		wLoggedDays++;
 	}
-	if(bTimeChanged){
-		bTimeChanged=0;
-		sprintf(str, "%02d", tTime.bHour);
-		LCDWriteStringXY(CLOCK_CURSOR_POSITION, 0, str);
-		sprintf(str, "%02d", tTime.bMin);
-		LCDWriteStringXY(CLOCK_CURSOR_POSITION+3, 0, str);
+	
+	if(wTodayLogs == 0){
+		word wFirstMin = (word)tNow.bHour*60 + tNow.bMin;
+		baRecord[bSize++] = tNow.bDay;
+		baRecord[bSize++] = tNow.bMonth;
+		baRecord[bSize++] = tNow.bYear;
+		// tells the reader the record layout
+		baRecord[bSize++] = getChannelMask() | ((bLogMode == LOG_MODE_DEADBAND)?LOG_HEADER_TIMESTAMPED:0);
+		// and where the records fall in the day: first one at wFirstMin, then one every wLogInterval minutes
+		memcpy(&baRecord[bSize], (byte*)&wLogInterval, sizeof(word));
+		bSize += sizeof(word);
+		memcpy(&baRecord[bSize], (byte*)&wFirstMin, sizeof(word));
+		bSize += sizeof(word);
+		bLogDay = tNow.bDay;
 	}
-	if(bTempChanged){
-		bTempChanged=0;
-		sprintf(str, "%04.1f", fTemperature);		// float printed with 4 digits (dot included), 1 of which is decimal, zero padded
-		LCDWriteStringXY(TEMP_CURSOR_POSITION,1, str);
-		LCDByte(0b11011111, 1);
-		LCDWriteStringXY(TEMP_CURSOR_POSITION+5, 1, "C,");
-		
+	if(bLogMode == LOG_MODE_DEADBAND){		// records are not evenly spaced: each one carries its time
+		baRecord[bSize++] = tNow.bHour;
+		baRecord[bSize++] = tNow.bMin;
+		baRecord[bSize++] = tNow.bSec;
 	}
-	if(bHumChanged){
-		bHumChanged=0;
-		float hundred = 99.95;
-		LCDWriteStringXY(HUM_CURSOR_POSITION-3, 1, "RH=");
-		if(fHumidity<hundred){
-			sprintf(str, "%04.1f", fHumidity);
-		}else{
-			sprintf(str, " %3.0f", fHumidity);
-		}
-		LCDWriteStringXY(HUM_CURSOR_POSITION, 1, str);
-		LCDWriteString("%");
+	for(j=0; j<ADC_NUMBER_OF_CHANNELS; j++){
+		if(!acChannels[j].bEnabled) continue;
+		statsToLog(&rsaInterval[j], &clLog);
+		stats_reset(&rsaInterval[j]);
+		memcpy(&baRecord[bSize], &clLog, sizeof(channel_log));
+		bSize += sizeof(channel_log);
 	}
+	statsToLog(&rsDewInterval, &clLog);
+	stats_reset(&rsDewInterval);
+	memcpy(&baRecord[bSize], &clLog, sizeof(channel_log));
+	bSize += sizeof(channel_log);
+	
+	logger_push(lLastIndex, baRecord, bSize);
+	lLastIndex += bSize;
+	wTodayLogs++;
+	
+	// Data, ora, LoggedDays, todayLogs e lastIndex: tutti contigui, un solo blocco ad ogni campionamento.
+	baStatus[EEPROM_DAY_ADD] = tNow.bDay;
+	baStatus[EEPROM_MONTH_ADD] = tNow.bMonth;
+	baStatus[EEPROM_YEAR_ADD] = tNow.bYear;
+	baStatus[EEPROM_MIN_ADD] = tNow.bMin;
+	baStatus[EEPROM_HOUR_ADD] = tNow.bHour;
+	memcpy(&baStatus[EEPROM_LOGGED_DAYS_ADD], (byte*)&wLoggedDays, sizeof(word));
+	memcpy(&baStatus[EEPROM_TODAY_LOGS_ADD], (byte*)&wTodayLogs, sizeof(word));
+	memcpy(&baStatus[EEPROM_LAST_INDEX_ADD], (byte*)&lLastIndex, sizeof(long));
+	logger_push(EEPROM_DAY_ADD, baStatus, EEPROM_STATUS_SIZE);
 }
 
-void dataLog(time_date *time, void * humidity, void * temperature){
-	START_ADC();
+
+/**
+ * \brief Draws the current page of the diagnostics screen.
+ *
+ * Memory page: .data, .bss and heap on the first line, stack high-water mark
+ * and never touched bytes on the second. Profiler slots: name and average on
+ * the first line, minimum and maximum on the second, microseconds.
+ */
+void printDiagnostics(void){
+	mem_report mrNow;
+#ifdef PROFILER_ENABLED
+	prof_stats psSlot;
+#endif
 	
+	if( bDiagPage == DIAG_PAGE_MEMORY ){
+		mem_getReport(&mrNow);
+		LCDClear();
+		pStr = fmt_uint(fmt_char(str, 'd'), mrNow.wData, 4, ' ');
+		pStr = fmt_uint(fmt_str_P(pStr, PSTR(" b")), mrNow.wBss, 4, ' ');
+		fmt_uint(fmt_str_P(pStr, PSTR(" h")), mrNow.wHeap, 3, ' ');
+		LCDWriteStringXY(0,0, str);
+		pStr = fmt_uint(fmt_str_P(str, PSTR("stk")), mrNow.wStackMax, 4, ' ');
+		fmt_uint(fmt_str_P(pStr, PSTR(" free")), mrNow.wFree, 4, ' ');
+		LCDWriteStringXY(0,1, str);
+		return;
+	}
+	if( bDiagPage == DIAG_PAGE_POWER ){		// how often the CPU wakes up, how often it finds work
+		LCDClear();
+		fmt_ulong(fmt_str_P(str, PSTR("wake")), lWakeUps, 12, ' ');
+		LCDWriteStringXY(0,0, str);
+		fmt_ulong(fmt_str_P(str, PSTR("work")), lWorkPasses, 12, ' ');
+		LCDWriteStringXY(0,1, str);
+		return;
+	}
+	if( bDiagPage == DIAG_PAGE_LOGGER ){		// EEPROM jobs given up (chip missing, bus fault), jobs waiting
+		LCDClear();
+		fmt_uint(fmt_str_P(str, PSTR("EEPROM err")), logger_errors(), 6, ' ');
+		LCDWriteStringXY(0,0, str);
+		fmt_uint(fmt_str_P(str, PSTR("coda")), logger_pending(), 12, ' ');
+		LCDWriteStringXY(0,1, str);
+		return;
+	}
+	if( bDiagPage == DIAG_PAGE_QUEUES ){		// dropped events and presses, last press: held for, waited for (ms)
+		LCDClear();
+		pStr = fmt_uint(fmt_str_P(str, PSTR("ovf ev")), event_overflows(), 3, ' ');
+		fmt_uint(fmt_str_P(pStr, PSTR(" btn")), button_overflows(), 3, ' ');
+		LCDWriteStringXY(0,0, str);
+		pStr = fmt_uint(fmt_str_P(str, PSTR("hld")), (beButton.wDuration < 6553)?beButton.wDuration*10:65530, 5, ' ');
+		fmt_uint(fmt_str_P(pStr, PSTR(" lag")), (wKeyLag < 999)?wKeyLag*10:9990, 4, ' ');
+		LCDWriteStringXY(0,1, str);
+		return;
+	}
+	
+#ifdef PROFILER_ENABLED
+	prof_get(bDiagPage - DIAG_PAGE_PROFILER, &psSlot);
+	if( !psSlot.wCount ) psSlot.wMin = 0;
+	LCDClear();
+	pStr = fmt_str_P(str, prof_name(bDiagPage - DIAG_PAGE_PROFILER));
+	while( pStr < str+5 ) pStr = fmt_char(pStr, ' ');
+	pStr = fmt_uint(fmt_str_P(pStr, PSTR(" avg")), (psSlot.wCount)?PROF_TICKS_TO_US(psSlot.lSum / psSlot.wCount):0, 5, ' ');
+	fmt_str_P(pStr, PSTR("us"));
+	LCDWriteStringXY(0,0, str);
+	pStr = fmt_uint(fmt_char(str, 'm'), PROF_TICKS_TO_US(psSlot.wMin), 5, ' ');
+	pStr = fmt_uint(fmt_str_P(pStr, PSTR(" M")), PROF_TICKS_TO_US(psSlot.wMax), 6, ' ');
+	fmt_str_P(pStr, PSTR("us"));
+	LCDWriteStringXY(0,1, str);
+#else
+	LCDClear();
+	LCDWriteStringXY_P(0,0, PSTR("Diagnostica"));
+	LCDWriteStringXY_P(0,1, PSTR("Profiler off"));
+#endif
 }
 
 
-void vConfirmState(void){
+/// Main loop, queue and logger counters on the serial port, after mem_dump().
+void dumpCounters(void){
+	char caLine[40];
 	
+	pStr = fmt_ulong(fmt_str_P(caLine, PSTR("wake ")), lWakeUps, 0, ' ');
+	pStr = fmt_ulong(fmt_str_P(pStr, PSTR(" work ")), lWorkPasses, 0, ' ');
+	fmt_str_P(pStr, PSTR("\r\n"));
+	uart_puts(caLine);
+	pStr = fmt_uint(fmt_str_P(caLine, PSTR("overflows events ")), event_overflows(), 0, ' ');
+	pStr = fmt_uint(fmt_str_P(pStr, PSTR(" buttons ")), button_overflows(), 0, ' ');
+	fmt_str_P(pStr, PSTR("\r\n"));
+	uart_puts(caLine);
+	fmt_str_P(fmt_uint(fmt_str_P(caLine, PSTR("eeprom errors ")), logger_errors(), 0, ' '), PSTR("\r\n"));
+	uart_puts(caLine);
+}
+
+
+/// Leaves the Si/No question for the menu: clears the editor and hides its cursor.
+static void vConfirmExit(void){
+	LCD_RESET();
+	bState = STATE_MENU;
+	bSelection=0;
+	bPrintQuotes=1;
+}
+
+/**
+ * \brief Si/No question over the editor: the setting is committed on Si.
+ */
+void vConfirmState(void){
 	switch(bBtn){
 		case NO_BTN:
 			if(bPrintQuotes){ 
-				LCDWriteStringXY(0,0, "Confermi? Si/No");
-				LCD_CURSOR_LEFT_N(5);
+				LCDWriteStringXY_P(0,0, PSTR("Confermi? Si/No"));
 				bPrintQuotes=0;
 				bSelection=0;
+				bSelectionChanged=1;
 			}
 			if(bSelectionChanged){
-				if(bSelection==0){		// Utilizzo bSelection per mantenere la scelta Si/No
-					LCD_SET_CURSOR_POSITION(10);
-				}else{
-					LCD_SET_CURSOR_POSITION(13);
-				}				
+				LCDGotoXY((bSelection==0)?10:13, 0);		// Utilizzo bSelection per mantenere la scelta Si/No
 				bSelectionChanged=0;
 			}
-							
 			break;
 						
 		case BTN_C:
@@ -1014,44 +1072,17 @@ void vConfirmState(void){
 			break;
 						
 		case BTN_C_LONG:
-			if(bSelection){
-				bState = STATE_MENU;
-				bSelection=0;
-			}
-			else{				// Confermo la modifica
-				switch(bState){
-					case STATE_EDIT_DATE_CONFIRM:
-						tTime.bDay = tTimeEditing.bDay;
-						tTime.bMonth = tTimeEditing.bMonth;
-						tTime.bYear = tTimeEditing.bYear;
-						break;
-						
-					case STATE_EDIT_TIME_CONFIRM:
-						tTime.bSec = tTimeEditing.bSec;
-						tTime.bMin = tTimeEditing.bMin;
-						tTime.bHour = tTimeEditing.bHour;
-						break;
-						
-					case STATE_EDIT_HUM_ON_TH_CONFIRM:
-						bHumOnThreshold = bHumOnThresholdEditing;
-						break;
-					
-					case STATE_EDIT_HUM_AL_TH_CONFIRM:
-						bHumAlarmThreshold = bHumAlarmThresholdEditing;
-						break;
-					
-					default: break;
-				}				
-				bState = STATE_MENU;
-				LCD_RESET();
-			}
+			if(!bSelection) editor_commit();		// Confermo la modifica
+			vConfirmExit();							// Si o No: si torna al menu senza cursore
+			bBtn = NO_BTN;
+			break;
+		default:
 			bBtn = NO_BTN;
-			bPrintQuotes=1;
 			break;
-		default: break;
 	}
 }
 
+
 uint8_t isValidTimeDate(volatile time_date * time){
 	
 	if(( time->bDay > 31 )||( time->bDay == 0 )) return 0;
@@ -1063,81 +1094,280 @@ uint8_t isValidTimeDate(volatile time_date * time){
 	return 1;
 }
 
-uint8_t isTimeToSample(volatile time_date *time){
-	if(((time->bHour*60 + time->bMin) % MINS_UNTIL_LOG)==0) return 1;
-	return 0;
+/**
+ * \brief Debounces all the buttons at once and runs the key state machines.
+ *
+ * Called every 10ms from the button scan with the raw pins (bit=1 --> pressed).
+ * A debounced bit flips after 4 equal samples (40ms): the two counter bytes
+ * hold a 2 bit counter per pin, so the cost does not depend on the number of
+ * buttons. On top of it every key of kdKeys[] posts its short press on release,
+ * and its long press (or the repeated code) while held.
+ */
+void vScanKeys(byte pressed){
+	byte bDelta, j, k, bDown;
+	key_state *ks;
+	
+	bDelta = pressed ^ bKeysDebounced;
+	bVCount1 = (bVCount1 ^ bVCount0) & bDelta;
+	bVCount0 = ~bVCount0 & bDelta;
+	bKeysDebounced ^= bDelta & ~(bVCount0 | bVCount1);		// counter wrapped: 4 samples in a row
+	
+	for(j=0; j<NUMBER_OF_KEYS; j++){
+		ks = &ksKeys[j];
+		bDown = (( bKeysDebounced & kdKeys[j].bMask ) == kdKeys[j].bMask);
+		if( bDown && ks->wTimer < 0xFFFF ) ks->wTimer++;
+		
+		switch( ks->bState ){
+			case KEY_RELEASED:
+				if( !bDown ) break;
+				ks->bState = KEY_PRESSED;
+				ks->wTimer = 0;
+				ks->bRepeat = 0;
+				for(k=j+1; k<NUMBER_OF_KEYS; k++){
+					if(( kdKeys[k].bMask & ~kdKeys[j].bMask ) == 0) ksKeys[k].bState = KEY_IGNORED;
+				}
+				break;
+				
+			case KEY_PRESSED:
+				if( !bDown ){
+					button_post(kdKeys[j].bCode, wTicks, ks->wTimer);
+					ks->bState = KEY_RELEASED;
+				}else if( kdKeys[j].bLongCode != KEY_REPEAT ){
+					if( ks->wTimer >= LONG_PRESSION_TIME ){
+						button_post(kdKeys[j].bLongCode, wTicks, ks->wTimer);
+						ks->bState = KEY_HELD;			// nothing more until released
+					}
+				}else if( ++ks->bRepeat >= REPEATED_PRESSION_TIME ){
+					button_post(kdKeys[j].bCode, wTicks, ks->wTimer);
+					ks->bRepeat = 0;
+					ks->bState = KEY_HELD;
+				}
+				break;
+				
+			case KEY_HELD:
+				if( !bDown ){
+					ks->bState = KEY_RELEASED;
+				}else if(( kdKeys[j].bLongCode == KEY_REPEAT )&&( ++ks->bRepeat >= REPEATED_PRESSION_TIME )){
+					button_post(kdKeys[j].bCode, wTicks, ks->wTimer);
+					ks->bRepeat = 0;
+				}
+				break;
+				
+			case KEY_IGNORED:
+				if( !bDown ) ks->bState = KEY_RELEASED;
+				break;
+		}
+	}
 }
 
-/*uint8_t updateEEPROM_TimeDate(volatile time_date * time){
-	byte error;
-	error = EEPROM_writeByte(EEPROM_DAY_ADD, time->bDay);
-	error |= EEPROM_writeByte(EEPROM_MONTH_ADD, time->bMonth);
-	error |= EEPROM_writeByte(EEPROM_YEAR_ADD, time->bYear);
-	error |= EEPROM_writeByte(EEPROM_MIN_ADD, time->bMin);
-	error |= EEPROM_writeByte(EEPROM_HOUR_ADD, time->bHour);
+/**
+ * \brief One second of the RTC: sampling and log scheduling.
+ *
+ * Called from the RTC interrupt of either backend, between the two bTimeSeq
+ * increments. Only counters are touched, the calendar is left to getTime():
+ * constant time, whatever the date.
+ */
+void vRtcSecond(void){
+	lEpoch++;
+	if( ++bRtcSec >= 60 ){
+		bRtcSec=0;
+		if( ++wRtcMinOfDay >= MINS_PER_DAY ){
+			wRtcMinOfDay=0;
+			bDateChanged=1;
+			event_post(EV_NEW_DAY, 0);
+		}
+		bTimeChanged=1;		// refresh quote every min for the minutes changing
+		
+		if(isTimeToSample(wRtcMinOfDay)) vLogDue();		// if it is time to log data into EEPROM
+	}
 	
-	if(error) return 1;
-	return 0;
-}*/
+	timer_tick();			// backlight, colon, acquisitions, deadband silence
+}
 
-uint8_t isLeapYear(byte year){
-	if(year % 4 == 0 && (year % 100 != 0 || year % 400 == 0)) return 1;
-	return 0;
+/// A record is due: it is written after this last acquisition (RTC interrupt).
+void vLogDue(void){
+	event_post(EV_LOG_DUE, 0);
+	timer_start(&tmSample, SAMPLE_PERIOD_S, SAMPLE_PERIOD_S, vSampleExpired);		// next acquisition counted from here
+	START_ADC();
+}
+
+void vSampleExpired(void){
+	START_ADC();				// faster internal acquisition between two log points
+}
+
+void vLogSilenceExpired(void){
+	vLogDue();					// deadband mode: maximum silence reached
+}
+
+void vColonExpired(void){
+	event_post(EV_TICK, 0);		// time colon is flashing at 1 Hz
+}
+
+void vBacklightExpired(void){
+	BACKLIGHT_OFF();
+}
+
+/**
+ * \brief Deadband mode: the next record is due at most wLogInterval minutes from now.
+ *
+ * Called when a record is triggered and when the log settings change.
+ */
+void armLogSilence(void){
+	if(bLogMode == LOG_MODE_DEADBAND){
+		timer_start(&tmLogSilence, wLogInterval*60, 0, vLogSilenceExpired);
+	}else{
+		timer_stop(&tmLogSilence);
+	}
+}
+
+/**
+ * \brief A log setting was changed from the menu (SETTING_* bit).
+ *
+ * The record spacing or layout changes: the next record starts with a new header.
+ */
+void vLogSettingsChanged(byte setting){
+	bSettingsDirty |= setting;		// queued by vSaveSettings() when the logger has room
+	if( setting & SETTING_LOG_MODE ) bLastLoggedSet = 0;	// the deadbands are measured from the next scan
+	wTodayLogs = 0;
+	armLogSilence();
 }
 
-uint8_t checkDay(volatile time_date *time, volatile byte *days){	
-	/* se bDay supera il valore massimo del corrispondente bMonth,	 *
-	 * esso viene portato al massimo valore consentito.				 */
+/**
+ * \brief Queues the settings changed from the menu, one per call.
+ *
+ * A setting waits while the logger queue has no room beyond the LOG_RECORD_JOBS
+ * slots of a record: the editor never waits for the EEPROM.
+ */
+void vSaveSettings(void){
+	if( logger_free() <= LOG_RECORD_JOBS ) return;
 	
-	if(time->bDay >= days[time->bMonth-1]){
-		if((time->bMonth == 2)&&(!isLeapYear(time->bYear)))
-			time->bDay = days[time->bMonth-1]-1;	// Caso Febbraio, anno non bisestile: bDays=28!
-		else
-			time->bDay = days[time->bMonth-1];
-		
-		return 1;
+	if( bSettingsDirty & SETTING_LOG_INTERVAL ){
+		logger_push(EEPROM_LOG_INTERVAL_ADD, (byte*)&wLogInterval, sizeof(word));
+		bSettingsDirty &= ~SETTING_LOG_INTERVAL;
+	}else if( bSettingsDirty & SETTING_LOG_MODE ){
+		logger_push(EEPROM_LOG_MODE_ADD, (byte*)&bLogMode, 1);
+		bSettingsDirty &= ~SETTING_LOG_MODE;
 	}
-	return 0;
 }
 
-void toggleTimeColon( void ){
-	if(bTimeCommaState){
-		LCDWriteStringXY(CLOCK_CURSOR_POSITION+2, 0, ":");
-		bTimeCommaState=0;
+/**
+ * \brief Nothing left for the main loop until the next interrupt.
+ *
+ * Called with interrupts disabled, right before going to sleep.
+ */
+uint8_t isMainLoopIdle(void){
+	if( event_pending() || button_pending() || logger_pending() || LCDTxPending() || bSettingsDirty ) return 0;
+	
+	if( bState == STATE_IDLE ){
+		if( isIdleScreenPending() ) return 0;		// only the current view: the flags of the others stay pending
+		if( logger_pending() != bLoggerShown ) return 0;
 	}else{
-		LCDWriteStringXY(CLOCK_CURSOR_POSITION+2, 0, " ");
-		bTimeCommaState=1;
+		if( bPrintQuotes || bSelectionMenuChanged || bSelectionChanged ) return 0;
+		if( bState == STATE_STATS && bStatsChanged ) return 0;		// set by the samples in every state
 	}
+	return 1;
 }
 
-void printIdleLCD( void ){
-	LCDClear();
+/**
+ * \brief Consistent copy of the RTC for the main loop, in calendar fields.
+ *
+ * Seqlock reader: the counters are read again if the RTC interrupt has run in
+ * the meantime, so interrupts are never disabled. The date of the current day
+ * is cached: the epoch --> calendar conversion runs once a day (or after the
+ * clock is set), every other call only splits the minutes of the day.
+ */
+void getTime(time_date *t){
+	byte bSeq;
+	longword lNow;
+	word wMinOfDay;
+	word wDays;
 	
-	bDateChanged = 1;
-	bTimeChanged = 1;
-	bHumChanged = 1;
-	bTempChanged = 1;
+	do{
+		bSeq = bTimeSeq;
+		lNow = lEpoch;
+		wMinOfDay = wRtcMinOfDay;
+		t->bSec = bRtcSec;
+		t->wMilli = wRtcMilli;
+	}while(( bSeq & 1 )||( bSeq != bTimeSeq ));
+	
+	t->bHour = wMinOfDay / 60;
+	t->bMin = wMinOfDay % 60;
 	
-	refreshQuote();
+	if(( lNow < lCachedMidnight )||( lNow - lCachedMidnight >= CAL_SECS_PER_DAY )){
+		wDays = lNow / CAL_SECS_PER_DAY;
+		lCachedMidnight = (longword)wDays * CAL_SECS_PER_DAY;
+		cal_fromDayNumber(wDays, &bCachedDay, &bCachedMonth, &bCachedYear);
+	}
+	t->bDay = bCachedDay;
+	t->bMonth = bCachedMonth;
+	t->bYear = bCachedYear;
+}
+
+/**
+ * \brief Sets the RTC from calendar fields (main loop).
+ */
+void setTime(time_date *t){
+	word wMinOfDay = (word)t->bHour*60 + t->bMin;
+	longword lNew = (longword)cal_dayNumber(t->bDay, t->bMonth, t->bYear)*CAL_SECS_PER_DAY + (longword)wMinOfDay*60 + t->bSec;
 	
-	//sprintf(str, "%02d/%02d/%02d", tTime.bDay, tTime.bMonth, tTime.bYear);
-	//LCDWriteStringXY(0,0,str);
-	//
-	//LCDWriteStringXY(CLOCK_CURSOR_POSITION,0,"00:00");
-	//LCDWriteStringXY(TEMP_CURSOR_POSITION,1,"00.0");
-	//LCDByte(0b11011111, 1);		// Scrive il carattere : dalla tabella 4 del datasheet HD44780.pdf vediamo che il carattere ? 11011111;
-								//// lo mandiamo come byte (LCDByte()) sapendo che dobbiamo mettere RS a 1 (dato!)
-	//LCDWriteStringXY(TEMP_CURSOR_POSITION+5, 1, "C,");
-	//LCDWriteStringXY(HUM_CURSOR_POSITION-3, 1, "RH=88.8%");
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE){		// the RTC interrupt is the other writer
+		lEpoch = lNew;
+		wRtcMinOfDay = wMinOfDay;
+		bRtcSec = t->bSec;
+		wRtcMilli = 0;
+	}
+}
+
+uint8_t isTimeToSample(word minOfDay){
+	if(bLogMode == LOG_MODE_DEADBAND) return 0;		// records follow the changes, tmLogSilence bounds the silence
+	if((minOfDay % wLogInterval)==0) return 1;
+	return 0;
+}
+
+/// LOG_MODE_DEADBAND: some enabled channel moved more than its deadband since the last record.
+uint8_t isOutsideDeadband(void){
+	byte j;
+	int16_t iDiff;
 	
+	for(j=0; j<ADC_NUMBER_OF_CHANNELS; j++){
+		if(!acChannels[j].bEnabled) continue;
+		iDiff = iaChannelValue[j] - iaLastLogged[j];
+		if(( iDiff > acChannels[j].iDeadband )||( iDiff < -acChannels[j].iDeadband )) return 1;
+	}
+	return 0;
 }
 
+uint8_t isValidLogInterval(word interval){
+	if(getLogIntervalIndex(interval) < NUMBER_OF_LOG_INTERVALS) return 1;
+	return 0;
+}
 
-int _round(double x){
-	if((x-((int)x))>0.5) return ((int)x)+1;
-	else return (int)x;
+void statsToLog(volatile running_stats *rs, channel_log *log){
+	if(rs->wCount == 0){		// no acquisition during the interval
+		log->iMean = LOG_NO_DATA;
+		log->iMin = LOG_NO_DATA;
+		log->iMax = LOG_NO_DATA;
+		return;
+	}
+	log->iMean = stats_mean(rs);
+	log->iMin = rs->iMin;
+	log->iMax = rs->iMax;
 }
 
+/*uint8_t updateEEPROM_TimeDate(volatile time_date * time){
+	byte error;
+	error = EEPROM_writeByte(EEPROM_DAY_ADD, time->bDay);
+	error |= EEPROM_writeByte(EEPROM_MONTH_ADD, time->bMonth);
+	error |= EEPROM_writeByte(EEPROM_YEAR_ADD, time->bYear);
+	error |= EEPROM_writeByte(EEPROM_MIN_ADD, time->bMin);
+	error |= EEPROM_writeByte(EEPROM_HOUR_ADD, time->bHour);
+	
+	if(error) return 1;
+	return 0;
+}*/
+
+
+
 
 
 // PAx --> Offset del pin x all'interno del registro PINA
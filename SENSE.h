@@ -31,6 +31,28 @@ Doxygen documenting commands:
 #define SENSE_H_
 
 //#define TESTING 1
+//#define PROFILER_ENABLED 1		// Timer1 + USART0 reserved for the ISR/main loop profiler
+
+/*  RTC_BACKEND  */
+#define RTC_TIMER0			0		// 100 Hz tick of Timer0 from the system clock: the CPU can only idle
+#define RTC_TIMER2_ASYNC	1		// 1 Hz tick of Timer2 from a 32.768 kHz watch crystal: power-save sleep
+
+/** \def RTC backend. The watch crystal takes the TOSC1/TOSC2 = XTAL1/XTAL2 pins, so with
+ * RTC_TIMER2_ASYNC the CPU runs on the internal 8 MHz RC oscillator (fuses!). */
+#ifndef RTC_BACKEND
+#define RTC_BACKEND	RTC_TIMER0
+#endif
+
+#if RTC_BACKEND == RTC_TIMER2_ASYNC
+  /** \def CPU Frequency := 8 MHz, internal RC */
+  #ifndef F_CPU
+  #define F_CPU 8000000UL
+  #endif
+  /** \def Twi bitrate := 100 KHz (400 KHz is too high for TWBR at 8 MHz) */
+  #ifndef TWI_BITRATE
+  #define TWI_BITRATE 100000UL
+  #endif
+#endif
 
 /** \def CPU Frequency := 16 MHz */
 #ifndef F_CPU
@@ -53,17 +75,31 @@ Doxygen documenting commands:
 #include <string.h>
 #include <avr/sfr_defs.h>
 
-#include <math.h>
 #ifndef _UTIL_DELAY_H_
   #include <util/delay.h>
 #endif
 
 //#include <util/24c_.c>
 #include <util/atomic.h>
+#include <avr/sleep.h>
 
 #include "SENSE_util/lcd.c"
 #include "SENSE_util/EEPROM.c"
+#include "SENSE_util/logger.c"
 #include "SENSE_util/i2c.c"
+#include "SENSE_util/stats.c"
+#include "SENSE_util/derived.c"
+#include "SENSE_util/calendar.c"
+#include "SENSE_util/events.c"
+#include "SENSE_util/timer.c"
+#include "SENSE_util/trend.c"
+#include "SENSE_util/screen.c"
+#include "SENSE_util/format.c"
+#include "SENSE_util/editor.c"
+#include "SENSE_util/uart.c"
+#include "SENSE_util/memcheck.c"
+#include "SENSE_util/profiler.c"
+#include "SENSE_ui.c"
 
 
 
@@ -75,6 +111,7 @@ Doxygen documenting commands:
 #define BUTTON_A				BIT2
 #define BUTTON_B				BIT4
 #define BUTTON_C				BIT3
+#define BUTTON_MASK				(BUTTON_A|BUTTON_B|BUTTON_C)
 
 #define BACKLIGHT_PORT			PORTD
 #define BACKLIGHT_PORT_DDR		DDRD
@@ -97,10 +134,10 @@ Doxygen documenting commands:
 #define BIT7	128
 
 
-#define DEBOUNCE_TIME				7		// RTC counting tens of milliseconds: this is 100ms!
-#define REPEATED_PRESSION_TIME		35		//
+// Debounce: 4 equal samples of the vertical counter, 40ms.
+#define REPEATED_PRESSION_TIME		35		// RTC counting tens of milliseconds: this is 350ms
 #define LONG_PRESSION_TIME			100		// 
-#define BACKLIGHT_TIME				800		// and this 8s.
+#define BACKLIGHT_TIME_S			8		// backlight timeout, seconds of the RTC tick
 
 
 /************* EEPROM ************/
@@ -115,27 +152,41 @@ Doxygen documenting commands:
 #define EEPROM_MIN_ADD					3
 #define EEPROM_HOUR_ADD					4
 #define EEPROM_LOGGED_DAYS_ADD			5		// 2 byte
-#define EEPROM_TODAY_LOGS_ADD			7
-#define EEPROM_LAST_INDEX_ADD			8		// 4 byte
-#define SIZE_OF_LOG					sizeof(float)
+#define EEPROM_TODAY_LOGS_ADD			7		// 2 byte
+#define EEPROM_LAST_INDEX_ADD			9		// 4 byte
+#define EEPROM_LOG_INTERVAL_ADD			13		// 2 byte
+#define EEPROM_LOG_MODE_ADD				15
+#define EEPROM_DATA_START_ADD			16		// first byte of the log area
+#define EEPROM_STATUS_SIZE				13		// DAY..LAST_INDEX: rewritten as one block after every record
+
+
+/************* Logging ***********/
+#define SAMPLE_PERIOD_S				10		// internal acquisition period between two log points (seconds)
+#define MINS_PER_DAY				(24*60)
+#define LOG_INTERVAL_DEFAULT		720		// 12h, two logs per day
+#define LOG_NO_DATA					STATS_NO_DATA	// written in place of a value when no sample was taken
+
+#define LOG_RECORD_JOBS				2		// logger_push() calls of a record: the record, then the status block
+#define LOG_HEADER_TIMESTAMPED		0x80	// set in the daily header mask: every record starts with hour, min, sec
+#define LOG_HEADER_SIZE				8		// day, month, year, mask, interval (word, min), minute of the day of the first record (word)
 
 
 
 
 /********** Sensors **********/
-#define VREF					5.0
-#define TEMP_SENSOR_GAIN		0.01   //  V / C   == 10 mV / C
+#define VREF_MV					5000		// ADC reference (AVCC) in mV, for the integer conversions
+#define BANDGAP_MV				1100		// internal reference, measured against VREF to get the supply voltage
 
-#define HIH_ZERO_OFFSET		0.826
-#define HIH_SLOPE			31.483
+#define PROBE_2_ENABLED			0		// second room probe (temperature on ADC3, humidity on ADC2)
+#define SUPPLY_MONITOR_ENABLED	1		// supply voltage through the internal bandgap channel
 
 
 
-/*	bPriLev  */
-#define PRI_TIMER0	1
-#define PRI_ADC		2
-#define PRI_TIMER2	3
-#define PRI_MAIN	9
+/*  event.bType  */
+#define EV_TICK				1		// one per second, from the RTC
+#define EV_SAMPLE_READY		2		// an ADC scan of all the enabled channels is complete
+#define EV_LOG_DUE			3		// a record has to be written after the next scan
+#define EV_NEW_DAY			4		// midnight
 
 
 /*  bBtn  */
@@ -150,36 +201,37 @@ Doxygen documenting commands:
 #define BTN_AB_LONG	9
 
 
-/*  bState  */
-#define STATE_IDLE							0
-#define STATE_MENU							1
-#define STATE_EDIT_DATE						2
-#define STATE_EDIT_DATE_CONFIRM				3
-#define STATE_EDIT_TIME						4
-#define STATE_EDIT_TIME_CONFIRM				5
-#define STATE_EDIT_HUM_ON_TH				6
-#define STATE_EDIT_HUM_ON_TH_CONFIRM		7
-#define STATE_EDIT_HUM_AL_TH				8
-#define STATE_EDIT_HUM_AL_TH_CONFIRM		9
-#define STATE_LOG_DATA						10
-
+/*  key_state.bState  */
+#define KEY_RELEASED		0
+#define KEY_PRESSED			1
+#define KEY_HELD			2		// long press posted, or repeating
+#define KEY_IGNORED			3		// part of a chord: silent until released
 
+#define KEY_REPEAT			0		// key_desc.bLongCode: no long press, the code repeats while held
+#define NUMBER_OF_KEYS		4
 
-/*  bSelectionMenu  */ //Occhio: questi valori devono essere congruenti con la posizione delle relative stringhe quando stampo il menu
-#define SEL_HUM_TH_1			0
-#define SEL_HUM_TH_2			1
-#define SEL_DATE				2
-#define SEL_TIME				3
 
-#define NUMBER_OF_OPTIONS		7
-
-
-
-/* LCD cursor position possible values */
-#define CLOCK_CURSOR_POSITION	11
-#define TEMP_CURSOR_POSITION	0
-#define HUM_CURSOR_POSITION		11
-#define ZONE_CURSOR_POSITION	19
+/*  bState  */
+#define STATE_IDLE							0
+#define STATE_MENU							1
+#define STATE_EDIT							2		// any setting: the editor descriptor comes from miMenu[]
+#define STATE_EDIT_CONFIRM					3
+#define STATE_DIAGNOSTICS					4
+#define STATE_STATS							5
+
+
+
+/*  bDiagPage  */
+#define DIAG_PAGE_MEMORY		0		// SRAM budget, sleep counters, queues, logger, then one page per profiler slot
+#define DIAG_PAGE_POWER			1
+#define DIAG_PAGE_QUEUES		2
+#define DIAG_PAGE_LOGGER		3
+#define DIAG_PAGE_PROFILER		4
+#ifdef PROFILER_ENABLED
+  #define NUMBER_OF_DIAG_PAGES	(DIAG_PAGE_PROFILER + PROF_NUMBER_OF_SLOTS)
+#else
+  #define NUMBER_OF_DIAG_PAGES	(DIAG_PAGE_PROFILER + 1)	// memory, power, queues, logger, "profiler off"
+#endif
 
 
 /************************************ Backlight Macros ***********************************/
@@ -188,17 +240,23 @@ Doxygen documenting commands:
 #define BACKLIGHT_ON() BACKLIGHT_PORT |= BACKLIGHT_PIN;
 #define BACKLIGHT_OFF() BACKLIGHT_PORT &= ~BACKLIGHT_PIN;
 
-#define TIMER2_CS	(1<<CS22)|(1<<CS21)|(1<<CS20)		// Timer2 clock selection bits: FCPU/1024
-
+// Both RTC backends: the timeout is a software timer on the 1 Hz tick.
 #define START_BACKLIGHT()\
 	BACKLIGHT_PORT |= BACKLIGHT_PIN;\
-	TCCR2B |= TIMER2_CS;
-
-//#define RESET_BACKLIGHT()\
+	timer_start(&tmBacklight, BACKLIGHT_TIME_S, 0, vBacklightExpired);
 
 #define STOP_BACKLIGHT()\
 	BACKLIGHT_PORT &= ~BACKLIGHT_PIN;\
-	TCCR2B &= ~(TIMER2_CS);
+	timer_stop(&tmBacklight);
+
+
+/************************************* Timer Macros *************************************/
+
+#if RTC_BACKEND == RTC_TIMER0
+  #define TIMER0_TOP		156								// ~10ms @ 16 MHz / 1024
+#else
+  #define TIMER0_TOP		((F_CPU/1024UL/100)-1)			// 10ms button scan, started by the pin change interrupt
+#endif
 
 
 /************************************* LCD Macros **************************************/
@@ -207,32 +265,24 @@ Doxygen documenting commands:
 #define LCD_SET_UNDERLINE_CURSOR	LCDCmd(0x0e);
 #define LCD_MAKE_CURSOR_INVISIBLE	LCDCmd(0x0c);
 
-#define LCD_CURSOR_LEFT_N(n)	for( i=0; i<n; i++ ){ LCDCmd(0x10); }
-#define LCD_CURSOR_RIGHT_N(n)	for( i=0; i<n; i++ ){ LCDCmd(0x14); }
-
-//changes cursor position keeping it in the same row
-#define LCD_SET_CURSOR_POSITION(n)\
-		LCDHome(); LCD_CURSOR_RIGHT_N(n)
-
 #define LCD_RESET()\
-		LCDClear(); LCDCmd(0x02); LCDCmd(0x0C);
+		LCDClear(); LCDHome(); LCDCmd(0x0C);
 
 
 /*********************************** ADC Macros ***************************************/
 
 #define ADC_PRESCALER_VALUE			(1<<ADPS2)|(1<<ADPS1)|(1<<ADPS0)
 
-#define ADC_HUMIDITY_CHANNEL		0
-#define ADC_TEMPERATURE_CHANNEL		1
-
-
-// ADC1, single ended
-#define ADC_SET_TEMPERATURE_CHANNEL()\
-	ADMUX=1<<MUX0;
+/* ADMUX values, single ended, reference on AREF. ADC4 and ADC5 are the TWI pins (external EEPROM). */
+#define ADC_MUX_ADC0				0
+#define ADC_MUX_ADC1				1
+#define ADC_MUX_ADC2				2
+#define ADC_MUX_ADC3				3
+#define ADC_MUX_ADC4				4
+#define ADC_MUX_ADC5				5
+#define ADC_MUX_BANDGAP				((1<<MUX3)|(1<<MUX2)|(1<<MUX1))
 
-// ADC0, single ended
-#define ADC_SET_HUMIDITY_CHANNEL()\
-	ADMUX=0;
+#define ADC_NO_CHANNEL				0xFF
 
 #define START_ADC()\
 	ADCSRA |= (1<<ADEN)|(1<<ADSC);
@@ -251,26 +301,24 @@ typedef uint32_t longword;
 
 
 typedef struct{
-	word wMilli;
-	byte bSec;
 	byte bMin;
 	byte bHour;
-	byte bDay;
-	byte bMonth;
-	byte bYear;
-} time_date;
+} time;
 
+/**
+ * \brief Key descriptor: a button, or a chord of buttons pressed together.
+ */
 typedef struct{
-	byte bMin;
-	byte bHour;
-} time;
+	byte	bMask;			///< BUTTON_* bits that make up the key.
+	byte	bCode;			///< BTN_* code of a short press (posted on release).
+	byte	bLongCode;		///< BTN_* code posted after LONG_PRESSION_TIME, or KEY_REPEAT.
+} key_desc;
 
 typedef struct{
-	word wA;
-	word wB;
-	word wC;
-	word wAB;
-} count;
+	byte	bState;			///< KEY_RELEASED, KEY_PRESSED, KEY_HELD, KEY_IGNORED.
+	byte	bRepeat;		///< Ticks since the last repeated code.
+	word	wTimer;			///< Ticks since the key went down.
+} key_state;
 
 typedef struct{
 	byte bDay;
@@ -278,24 +326,50 @@ typedef struct{
 	byte bYear;
 } date;
 
-#define MINS_UNTIL_LOG					720
-#define NUMBER_OF_LOGS_PER_DAY			24*60/MINS_UNTIL_LOG
+/**
+ * \brief Converts a raw ADC reading into the channel unit.
+ *
+ * \a ref is the last value of the descriptor's reference channel (the probe
+ * temperature for humidity compensation), ignored by the other conversions.
+ */
+typedef int16_t (*adc_conversion)(word adc, int16_t ref);
 
+/**
+ * \brief ADC channel descriptor: one entry of the scan table.
+ */
 typedef struct{
-	date	dDate;
-	float	fValues[NUMBER_OF_LOGS_PER_DAY];
-} daily_log_type;
+	byte			bMux;			///< ADMUX value selecting the input.
+	adc_conversion	fConvert;		///< Raw reading --> tenths of unit (mV for the supply).
+	byte			bRef;			///< Channel passed as \a ref to fConvert.
+	byte			bDiscard;		///< Conversions thrown away after switching to this input.
+	byte			bEnabled;		///< Channel included in the scan and in the log record.
+	int16_t			iDeadband;		///< LOG_MODE_DEADBAND: change from the last logged value that triggers a record.
+} adc_channel;
 
-//typedef struct{
-	//daily_log_type dltHumidity;
-	//daily_log_type dltTemperature;
-//} daily_log;
+/**
+ * \brief One channel of a log record, as it is written into EEPROM.
+ *
+ * Values are in tenths of unit (0.1 C, 0.1 %RH), taken from the running_stats
+ * of the interval. A record holds one channel_log per enabled ADC channel, in
+ * scan order, followed by the dew point; the enabled channel mask is written
+ * in the daily header.
+ */
+typedef struct{
+	int16_t iMean;
+	int16_t iMin;
+	int16_t iMax;
+} channel_log;
 
+/**
+ * \brief Menu entry: the editor of a setting, or a screen with a state of its own.
+ */
 typedef struct{
-	date dDate;
-	float fHumValues[NUMBER_OF_LOGS_PER_DAY];
-	float fTempValues[NUMBER_OF_LOGS_PER_DAY];
-}daily_log;
+	byte				bState;			///< STATE_EDIT, or the state entered.
+	const editor_desc	*pEditor;		///< STATE_EDIT: the setting (PROGMEM descriptor).
+} menu_item;
+
+#define LOG_RECORD_MAX_CHANNELS		(ADC_NUMBER_OF_CHANNELS+1)
+#define LOG_RECORD_MAX_SIZE			(LOG_HEADER_SIZE + 3 + LOG_RECORD_MAX_CHANNELS*sizeof(channel_log))	// header + timestamp + data, <= LOGGER_JOB_SIZE
 
 
 /*************************************************************************************/
@@ -306,25 +380,41 @@ void init_EEPROM(void);
 void init_ADC(void);
 void init_LCD(uint8_t bPowerUp);
 void init_TIMER0_B(void);
-void init_TIMER2_B(void);
+void init_SOFT_TIMERS(void);
+void init_TIMER2_ASYNC(void);
+void init_BUTTONS_PCINT(void);
+void vRtcSecond(void);
+void vLogDue(void);
+void vSampleExpired(void);
+void vLogSilenceExpired(void);
+void vColonExpired(void);
+void vBacklightExpired(void);
+void armLogSilence(void);
+void vSaveSettings(void);
+void vScanKeys(byte pressed);
 void _init_AVR(void);
 void init_CTRL_Data_fromEEPROM(void);
-float getTemperature(void);
-float getHumidity(float temperature);
-void refreshQuote(void);
+int16_t getTemperature(word adc, int16_t ref);
+int16_t getHumidity(word adc, int16_t temperature);
+int16_t getSupplyVoltage(word adc, int16_t ref);
+uint8_t selectNextChannel(byte from);
+byte getChannelMask(void);
+uint8_t isOutsideDeadband(void);
+uint8_t isMainLoopIdle(void);
 void vConfirmState(void);
-uint8_t isLeapYear(byte year);
-uint8_t checkDay(volatile time_date *time, volatile byte* days);
-void toggleTimeColon(void);
-void printIdleLCD(void);
-int _round(double x);
+void printDiagnostics(void);
+void dumpCounters(void);
+void vDispatch(event *ev);
+void vOnSampleReady(void);
+void vLogData(void);
 uint8_t isValidTimeDate(volatile time_date * time);
-uint8_t isTimeToSample(volatile time_date * time);
+uint8_t isTimeToSample(word minOfDay);
+uint8_t isValidLogInterval(word interval);
+void statsToLog(volatile running_stats *rs, channel_log *log);
 //uint8_t updateEEPROM_TimeDate(volatile time_date * time);
 //void dataLog();
 
 char *itoa(int value, char * str, int base);
-int sprintf(char * str, const char * format, ...);
 
 
 
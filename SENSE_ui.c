@@ -0,0 +1,450 @@
+/**
+ * \file SENSE_ui.c
+ * \brief Screens and settings of the user interface, main file.
+ *
+ * Field tables of the idle, menu and statistics screens, editor descriptors of
+ * the settings, and the formatters and load/commit callbacks they point to.
+ * The firmware builds this file through SENSE.h; the host simulator in sim/
+ * builds the same file, so `make -C sim check` exercises these tables.
+ *
+ * Measures, statistics and log settings belong to SENSE.c: the declarations
+ * this file needs from it are listed in SENSE_ui.h.
+ */
+
+#include <avr/pgmspace.h>
+#include <util/atomic.h>
+#include "SENSE_ui.h"
+#include "SENSE_util/lcd.h"
+#include "SENSE_util/format.h"
+#include "SENSE_util/logger.h"
+
+
+volatile uint8_t bTimeChanged;				///< Reports time is changed and quotes have to be refreshed
+volatile uint8_t bDateChanged;				///< Reports date has changed.
+volatile uint8_t bTempChanged;				///< Reports temperature has changed.
+volatile uint8_t bHumChanged;				///< Reports humidity has changed.
+volatile uint8_t bDerivedChanged;			///< Reports dew point or absolute humidity has changed.
+volatile uint8_t bSelectionMenu;
+volatile uint8_t bSelectionMenuChanged;
+volatile uint8_t bTimeCommaState;			///< Colon of the clock shown.
+uint8_t bColonChanged;
+uint8_t bLoggerChanged;					///< The logger queue depth differs from bLoggerShown.
+time_date tShown;						///< Time drawn by the idle screen, read once per refresh.
+volatile uint8_t bIdleView=IDLE_VIEW_MEASURES;	///< What the second line of the idle screen shows.
+uint8_t bTrendChanged;					///< New samples (or CGRAM still to be updated) for the trend view.
+uint8_t bLoggerShown;					///< Logger queue depth currently on the idle screen.
+uint8_t bStatsPage;						///< Page of the statistics screen (STATS_PAGE_*).
+uint8_t bStatsChanged;					///< New sample, new day or new page for the statistics screen.
+
+const char options[NUMBER_OF_OPTIONS+1][16] PROGMEM={"1.Soglia 1-DEUM","2.Soglia 2-ALL ", "3.Data         ",
+					"4.Ora          ", "5.Interv. log  ", "6.Modo log     ", "7.Diagnostica  ", "8.Statistiche  ", "              "};
+const char logModes[2][4] PROGMEM={"Per", "Var"};
+
+/*  Screen layouts: position, width, formatter, update flag  */
+const screen_field sfIdleTop[] PROGMEM={
+	{	0,							0,	9,	fmtDate,		&bDateChanged	},
+	{	LOGGER_CURSOR_POSITION,		0,	1,	fmtLogger,		&bLoggerChanged	},		// records still being written
+	{	CLOCK_CURSOR_POSITION,		0,	2,	fmtHour,		&bTimeChanged	},
+	{	CLOCK_CURSOR_POSITION+2,	0,	1,	fmtColon,		&bColonChanged	},
+	{	CLOCK_CURSOR_POSITION+3,	0,	2,	fmtMinute,		&bTimeChanged	}
+};
+const screen_field sfIdleMeasures[] PROGMEM={
+	{	TEMP_CURSOR_POSITION,		1,	7,	fmtTemperature,	&bTempChanged	},
+	{	HUM_CURSOR_POSITION-3,		1,	8,	fmtHumidity,	&bHumChanged	}
+};
+const screen_field sfIdleDerived[] PROGMEM={
+	{	DEW_CURSOR_POSITION,		1,	9,	fmtDewPoint,	&bDerivedChanged	},
+	{	AH_CURSOR_POSITION-2,		1,	6,	fmtAbsHumidity,	&bDerivedChanged	}
+};
+const screen_field sfIdleTrend[] PROGMEM={
+	{	TREND_TEMP_CURSOR_POSITION,	1,	6,	fmtTrendTemp,	&bTrendChanged	},
+	{	TREND_HUM_CURSOR_POSITION,	1,	6,	fmtTrendHum,	&bTrendChanged	}
+};
+/// Second line of the idle screen, indexed by bIdleView.
+const screen_view svIdleViews[NUMBER_OF_IDLE_VIEWS] PROGMEM={
+	{	sfIdleMeasures,	SCREEN_FIELDS(sfIdleMeasures)	},
+	{	sfIdleDerived,	SCREEN_FIELDS(sfIdleDerived)	},
+	{	sfIdleTrend,	SCREEN_FIELDS(sfIdleTrend)		}
+};
+const screen_field sfMenu[] PROGMEM={
+	{	0,	0,	16,	fmtMenuSelected,	&bSelectionMenuChanged	},
+	{	0,	1,	16,	fmtMenuNext,		&bSelectionMenuChanged	}
+};
+
+
+/*  Settings: column, width, min, max, step, wrap, dynamic max, formatter  */
+const edit_field efDate[] PROGMEM={
+	{	3,	2,	1,	31,	1,	1,	maxDay,	NULL	},		// day: up to the end of the month being edited
+	{	6,	2,	1,	12,	1,	1,	NULL,	NULL	},
+	{	9,	2,	0,	99,	1,	1,	NULL,	NULL	}
+};
+const edit_field efTime[] PROGMEM={
+	{	3,	2,	0,	23,	1,	1,	NULL,	NULL	},
+	{	6,	2,	0,	59,	1,	1,	NULL,	NULL	},
+	{	9,	2,	0,	59,	1,	1,	NULL,	NULL	}
+};
+const edit_field efHumThreshold[] PROGMEM={
+	{	11,	2,	0,	99,	1,	1,	NULL,	NULL	}
+};
+const edit_field efLogInterval[] PROGMEM={
+	{	10,	5,	0,	NUMBER_OF_LOG_INTERVALS-1,	1,	1,	NULL,	fmtLogIntervalValue	}	// index into waLogIntervals[]
+};
+const edit_field efLogMode[] PROGMEM={
+	{	10,	3,	LOG_MODE_PERIODIC,	LOG_MODE_DEADBAND,	1,	1,	NULL,	fmtLogModeValue	}
+};
+
+const char tDate[] PROGMEM="Editing date:";
+const char tTime[] PROGMEM="Editing time:";
+const char tHumOn[] PROGMEM="Edit Hum-On TH:";
+const char tHumAl[] PROGMEM="Edit Hum-Al TH:";
+const char tLogInterval[] PROGMEM="Edit log interv:";
+const char tLogMode[] PROGMEM="Edit log mode:";
+
+const editor_desc edDate[] PROGMEM={		{ tDate,		loadDate,			commitDate,			efDate,			EDITOR_FIELDS(efDate)			} };
+const editor_desc edTime[] PROGMEM={		{ tTime,		loadTime,			commitTime,			efTime,			EDITOR_FIELDS(efTime)			} };
+const editor_desc edHumOn[] PROGMEM={		{ tHumOn,		loadHumOnTh,		commitHumOnTh,		efHumThreshold,	EDITOR_FIELDS(efHumThreshold)	} };
+const editor_desc edHumAl[] PROGMEM={		{ tHumAl,		loadHumAlTh,		commitHumAlTh,		efHumThreshold,	EDITOR_FIELDS(efHumThreshold)	} };
+const editor_desc edLogInterval[] PROGMEM={	{ tLogInterval,	loadLogInterval,	commitLogInterval,	efLogInterval,	EDITOR_FIELDS(efLogInterval)	} };
+const editor_desc edLogMode[] PROGMEM={		{ tLogMode,		loadLogMode,		commitLogMode,		efLogMode,		EDITOR_FIELDS(efLogMode)		} };
+
+const char caStatsNames[NUMBER_OF_STATS_PAGES][8] PROGMEM={"T oggi", "UR oggi", "T ieri", "UR ieri"};
+const screen_field sfStats[] PROGMEM={
+	{	0,	0,	8,	fmtStatsTitle,	&bStatsChanged	},
+	{	8,	0,	8,	fmtStatsMean,	&bStatsChanged	},
+	{	0,	1,	8,	fmtStatsMin,	&bStatsChanged	},
+	{	8,	1,	8,	fmtStatsMax,	&bStatsChanged	}
+};
+const screen_field sfStatsDetail[] PROGMEM={
+	{	0,	0,	8,	fmtStatsTitle,		&bStatsChanged	},
+	{	8,	0,	8,	fmtStatsDev,		&bStatsChanged	},
+	{	0,	1,	8,	fmtStatsMinTime,	&bStatsChanged	},
+	{	8,	1,	8,	fmtStatsMaxTime,	&bStatsChanged	}
+};
+
+/// Log intervals selectable from the menu (minutes): all of them divide a day.
+uint16_t waLogIntervals[NUMBER_OF_LOG_INTERVALS]={1, 2, 5, 10, 15, 30, 60, 120, 180, 240, 360, 720};
+
+
+/************************************************************************************/
+/*******************************   Idle screen   ************************************/
+/************************************************************************************/
+
+/**
+ * \brief Idle screen: redraws the fields whose data has changed.
+ *
+ * The first line (date, logger queue, clock) is common, the second one is
+ * the table of the current bIdleView.
+ */
+void refreshQuote(){
+	screen_view svView;
+	
+	getTime(&tShown);
+	if( logger_pending() != bLoggerShown ) bLoggerChanged=1;
+	screen_render(sfIdleTop, SCREEN_FIELDS(sfIdleTop));
+	
+	if( bIdleView == IDLE_VIEW_TREND && bTrendChanged && !loadTrendGlyphs() ) return;	// CGRAM first: next pass
+	memcpy_P(&svView, &svIdleViews[bIdleView], sizeof(screen_view));
+	screen_render(svView.pFields, svView.bCount);
+}
+
+/// The whole idle screen will be drawn at the next refreshQuote().
+void invalidateIdleScreen(void){
+	screen_view svView;
+	
+	screen_invalidate(sfIdleTop, SCREEN_FIELDS(sfIdleTop));
+	memcpy_P(&svView, &svIdleViews[bIdleView], sizeof(screen_view));
+	screen_invalidate(svView.pFields, svView.bCount);
+}
+
+uint8_t isIdleScreenPending(void){
+	screen_view svView;
+	
+	memcpy_P(&svView, &svIdleViews[bIdleView], sizeof(screen_view));
+	return screen_pending(sfIdleTop, SCREEN_FIELDS(sfIdleTop)) || screen_pending(svView.pFields, svView.bCount);
+}
+void toggleTimeColon( void ){
+	bTimeCommaState = !bTimeCommaState;
+	bColonChanged=1;
+}
+/**
+ * \brief Trend view: rebuilds the custom characters from the sample rings.
+ *
+ * LCDDefineChar() only queues the pixel rows that changed. Returns 0 if the
+ * LCD queue is too full: the remaining glyphs are sent at the next pass.
+ */
+uint8_t loadTrendGlyphs( void ){
+	uint8_t baRows[TREND_GLYPH_ROWS];
+	uint8_t g;
+	
+	for(g=0; g<TREND_GLYPHS; g++){
+		trend_glyph(&thTemp, g, baRows);
+		if( !LCDDefineChar(TREND_TEMP_GLYPH+g, baRows) ) return 0;
+		trend_glyph(&thHum, g, baRows);
+		if( !LCDDefineChar(TREND_HUM_GLYPH+g, baRows) ) return 0;
+	}
+	return 1;
+}
+void printIdleLCD( void ){
+	LCDClear();
+	invalidateIdleScreen();
+	refreshQuote();
+	
+	//sprintf(str, "%02d/%02d/%02d", tTime.bDay, tTime.bMonth, tTime.bYear);
+	//LCDWriteStringXY(0,0,str);
+	//
+	//LCDWriteStringXY(CLOCK_CURSOR_POSITION,0,"00:00");
+	//LCDWriteStringXY(TEMP_CURSOR_POSITION,1,"00.0");
+	//LCDByte(0b11011111, 1);		// Scrive il carattere : dalla tabella 4 del datasheet HD44780.pdf vediamo che il carattere ? 11011111;
+								//// lo mandiamo come byte (LCDByte()) sapendo che dobbiamo mettere RS a 1 (dato!)
+	//LCDWriteStringXY(TEMP_CURSOR_POSITION+5, 1, "C,");
+	//LCDWriteStringXY(HUM_CURSOR_POSITION-3, 1, "RH=88.8%");
+	
+}
+
+/************************************************************************************/
+/******************************   Screen fields   ***********************************/
+/************************************************************************************/
+
+void fmtDate(char *dst){
+	fmt_char(fmt_date(dst, tShown.bDay, tShown.bMonth, tShown.bYear), ',');
+}
+
+void fmtLogger(char *dst){
+	bLoggerShown = logger_pending();
+	fmt_char(dst, (bLoggerShown)?('0'+bLoggerShown):' ');
+}
+
+void fmtHour(char *dst){
+	fmt_u2(dst, tShown.bHour);
+}
+
+void fmtColon(char *dst){
+	fmt_char(dst, (bTimeCommaState)?':':' ');
+}
+
+void fmtMinute(char *dst){
+	fmt_u2(dst, tShown.bMin);
+}
+
+/// "21.5C," : 4 digits (dot included), 1 of which is decimal, zero padded.
+void fmtTemperature(char *dst){
+	fmt_str_P(fmt_char(fmt_fixed1(dst, iaChannelValue[ADC_CH_TEMPERATURE], 4, '0'), 0b11011111), PSTR("C,"));
+}
+
+void fmtHumidity(char *dst){
+	dst = fmt_str_P(dst, PSTR("RH="));
+	if(iaChannelValue[ADC_CH_HUMIDITY]<1000){
+		dst = fmt_fixed1(dst, iaChannelValue[ADC_CH_HUMIDITY], 4, '0');
+	}else{
+		dst = fmt_uint(fmt_char(dst, ' '), (iaChannelValue[ADC_CH_HUMIDITY]+5)/10, 3, ' ');
+	}
+	fmt_char(dst, '%');
+}
+
+void fmtDewPoint(char *dst){
+	fmt_char(fmt_char(fmt_fixed1(fmt_str_P(dst, PSTR("Td")), iDewPoint, 5, ' '), 0b11011111), 'C');
+}
+
+void fmtAbsHumidity(char *dst){
+	fmt_fixed1(fmt_str_P(dst, PSTR("AH")), wAbsHumidity, 4, ' ');
+}
+
+/// Label and the custom characters loaded by loadTrendGlyphs().
+static void vFmtTrend(char *dst, char label, uint8_t first){
+	uint8_t g;
+	
+	dst = fmt_char(fmt_char(dst, label), ' ');
+	for(g=0; g<TREND_GLYPHS; g++) dst = fmt_char(dst, LCD_CGRAM_CHAR(first+g));
+}
+
+void fmtTrendTemp(char *dst){
+	vFmtTrend(dst, 'T', TREND_TEMP_GLYPH);
+}
+
+void fmtTrendHum(char *dst){
+	vFmtTrend(dst, 'H', TREND_HUM_GLYPH);
+}
+
+void fmtMenuSelected(char *dst){
+	fmt_str_P(fmt_char(dst, '-'), options[bSelectionMenu]);		// straight from flash
+}
+
+void fmtMenuNext(char *dst){
+	fmt_str_P(fmt_char(dst, ' '), options[bSelectionMenu+1]);
+}
+
+/// Accumulators shown by the statistics page: humidity on odd pages, yesterday on the second half.
+static running_stats *pStatsOfPage(void){
+	if( bStatsPage & STATS_PAGE_YESTERDAY ) return (bStatsPage & STATS_PAGE_HUMIDITY)?&rsHumYesterday:&rsTempYesterday;
+	return (bStatsPage & STATS_PAGE_HUMIDITY)?&rsHumToday:&rsTempToday;
+}
+
+/// "min 19.8" : label and value in tenths, "--.-" before the first sample.
+static void vFmtStat(char *dst, const char *label, int16_t value){
+	dst = fmt_str_P(dst, label);
+	if( !pStatsOfPage()->wCount ) fmt_str_P(dst, PSTR(" --.-"));
+	else fmt_fixed1(dst, value, 5, ' ');
+}
+
+void fmtStatsTitle(char *dst){
+	fmt_str_P(dst, caStatsNames[bStatsPage]);
+}
+
+void fmtStatsMean(char *dst){
+	vFmtStat(dst, PSTR("med"), stats_mean(pStatsOfPage()));
+}
+
+void fmtStatsMin(char *dst){
+	vFmtStat(dst, PSTR("min"), pStatsOfPage()->iMin);
+}
+
+void fmtStatsMax(char *dst){
+	vFmtStat(dst, PSTR("max"), pStatsOfPage()->iMax);
+}
+
+void fmtStatsDev(char *dst){
+	vFmtStat(dst, PSTR("dev"), stats_stdDev(pStatsOfPage()));
+}
+
+/// "m  06:12" : when the extreme was reached.
+static void vFmtStatTime(char *dst, char label, uint8_t hour, uint8_t min){
+	dst = fmt_str_P(fmt_char(dst, label), PSTR("  "));
+	if( !pStatsOfPage()->wCount ) fmt_str_P(dst, PSTR("--:--"));
+	else fmt_u2(fmt_char(fmt_u2(dst, hour), ':'), min);
+}
+
+void fmtStatsMinTime(char *dst){
+	running_stats *rs = pStatsOfPage();
+	vFmtStatTime(dst, 'm', rs->bMinHour, rs->bMinMin);
+}
+
+void fmtStatsMaxTime(char *dst){
+	running_stats *rs = pStatsOfPage();
+	vFmtStatTime(dst, 'M', rs->bMaxHour, rs->bMaxMin);
+}
+
+
+/************************************************************************************/
+/***************************   Settings (editor)   **********************************/
+/************************************************************************************/
+
+/// Date and time editors: the current value, once more on the second line as a reference.
+void loadDate(uint8_t *values, char *line){
+	time_date tNow;
+	
+	getTime(&tNow);
+	values[0] = tNow.bDay;
+	values[1] = tNow.bMonth;
+	values[2] = tNow.bYear;
+	fmt_date(fmt_str_P(line, PSTR("   ")), tNow.bDay, tNow.bMonth, tNow.bYear);
+}
+
+void commitDate(const uint8_t *values){
+	time_date tNow;
+	uint16_t wOldDay;
+	
+	getTime(&tNow);
+	wOldDay = cal_dayNumber(tNow.bDay, tNow.bMonth, tNow.bYear);
+	tNow.bDay = values[0];
+	tNow.bMonth = values[1];
+	tNow.bYear = values[2];
+	setTime(&tNow);
+	bDateChanged=1;
+	// another day: the daily statistics roll over as they do at midnight
+	if( cal_dayNumber(tNow.bDay, tNow.bMonth, tNow.bYear) != wOldDay ) vNewDay();
+}
+
+uint8_t maxDay(const uint8_t *values){
+	return cal_daysInMonth(values[1], values[2]);
+}
+
+void loadTime(uint8_t *values, char *line){
+	time_date tNow;
+	
+	getTime(&tNow);
+	values[0] = tNow.bHour;
+	values[1] = tNow.bMin;
+	values[2] = tNow.bSec;
+	fmt_time(fmt_str_P(line, PSTR("   ")), tNow.bHour, tNow.bMin, tNow.bSec);
+}
+
+void commitTime(const uint8_t *values){
+	time_date tNow;
+	
+	getTime(&tNow);
+	tNow.bHour = values[0];
+	tNow.bMin = values[1];
+	tNow.bSec = values[2];
+	setTime(&tNow);
+}
+
+/// "p:45RH,  c:45 RH" : previous and current threshold.
+static void vLoadThreshold(uint8_t *values, char *line, uint8_t threshold){
+	char *p;
+	
+	values[0] = threshold;
+	p = fmt_str_P(line, PSTR("p:"));
+	p = fmt_u2(p, threshold);
+	p = fmt_str_P(p, PSTR("RH,  c:"));
+	p = fmt_u2(p, threshold);
+	fmt_str_P(p, PSTR(" RH"));
+}
+
+void loadHumOnTh(uint8_t *values, char *line){
+	vLoadThreshold(values, line, bHumOnThreshold);
+}
+
+void commitHumOnTh(const uint8_t *values){
+	bHumOnThreshold = values[0];
+}
+
+void loadHumAlTh(uint8_t *values, char *line){
+	vLoadThreshold(values, line, bHumAlarmThreshold);
+}
+
+void commitHumAlTh(const uint8_t *values){
+	bHumAlarmThreshold = values[0];
+}
+
+void loadLogInterval(uint8_t *values, char *line){
+	values[0] = getLogIntervalIndex(wLogInterval);
+	fmt_str_P(fmt_hm(fmt_str_P(line, PSTR("p:")), wLogInterval), PSTR(" c:"));
+}
+
+void commitLogInterval(const uint8_t *values){
+	if(wLogInterval != waLogIntervals[values[0]]){
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE){		// read by isTimeToSample() inside the RTC interrupt
+			wLogInterval = waLogIntervals[values[0]];
+		}
+		vLogSettingsChanged(SETTING_LOG_INTERVAL);
+	}
+}
+
+void fmtLogIntervalValue(char *dst, uint8_t value){
+	fmt_hm(dst, waLogIntervals[value]);
+}
+
+void loadLogMode(uint8_t *values, char *line){
+	values[0] = bLogMode;
+	fmt_str_P(fmt_str_P(fmt_str_P(line, PSTR("p:")), logModes[bLogMode]), PSTR("   c:"));
+}
+
+void commitLogMode(const uint8_t *values){
+	if(bLogMode != values[0]){
+		bLogMode = values[0];
+		vLogSettingsChanged(SETTING_LOG_MODE);
+	}
+}
+
+void fmtLogModeValue(char *dst, uint8_t value){
+	fmt_str_P(dst, logModes[value]);
+}
+
+uint8_t getLogIntervalIndex(uint16_t interval){
+	uint8_t j;
+	
+	for(j=0; j<NUMBER_OF_LOG_INTERVALS; j++){
+		if(waLogIntervals[j] == interval) return j;
+	}
+	return NUMBER_OF_LOG_INTERVALS;
+}
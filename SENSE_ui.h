@@ -0,0 +1,182 @@
+/**
+ * \file SENSE_ui.h
+ * \brief Screens and settings of the user interface, header file.
+ *
+ * Positions and pages of the screens, the flags that ask for a redraw, and
+ * what SENSE_ui.c needs from the application: measures, statistics and log
+ * settings, the RTC, the hooks called when a setting changes. The firmware
+ * defines them in SENSE.c, the host simulator in sim/lcdsim.c.
+ */
+
+#ifndef SENSE_UI_H_
+#define SENSE_UI_H_
+
+#include <stdint.h>
+#include <avr/pgmspace.h>
+#include "SENSE_util/screen.h"
+#include "SENSE_util/editor.h"
+#include "SENSE_util/stats.h"
+#include "SENSE_util/trend.h"
+#include "SENSE_util/calendar.h"
+
+
+/* Index of the channels inside acChannels[], which is also the scan order:
+ * every humidity channel comes after the temperature it is compensated with. */
+#define ADC_CH_TEMPERATURE			0		// ADC1, main probe
+#define ADC_CH_HUMIDITY				1		// ADC0, main probe
+#define ADC_CH_TEMPERATURE_2		2		// ADC3, second room probe
+#define ADC_CH_HUMIDITY_2			3		// ADC2, second room probe
+#define ADC_CH_SUPPLY				4		// bandgap, supply voltage in mV
+
+#define ADC_NUMBER_OF_CHANNELS		5
+
+
+#define NUMBER_OF_LOG_INTERVALS		12		// entries of waLogIntervals[]
+
+/*  bLogMode  */
+#define LOG_MODE_PERIODIC			0		// one record every wLogInterval minutes
+#define LOG_MODE_DEADBAND			1		// one record when a channel leaves its deadband, or after wLogInterval minutes of silence
+
+/*  bSettingsDirty: settings changed from the menu, still to be queued for the EEPROM  */
+#define SETTING_LOG_INTERVAL		0x01
+#define SETTING_LOG_MODE			0x02
+
+
+/*  bSelectionMenu  */ //Occhio: questi valori devono essere congruenti con la posizione delle relative stringhe quando stampo il menu
+#define SEL_HUM_TH_1			0
+#define SEL_HUM_TH_2			1
+#define SEL_DATE				2
+#define SEL_TIME				3
+#define SEL_LOG_INTERVAL		4
+#define SEL_LOG_MODE			5
+#define SEL_DIAGNOSTICS			6
+#define SEL_STATISTICS			7
+
+#define NUMBER_OF_OPTIONS		8
+
+
+
+/* LCD cursor position possible values */
+#define CLOCK_CURSOR_POSITION	11
+#define TEMP_CURSOR_POSITION	0
+#define HUM_CURSOR_POSITION		11
+#define ZONE_CURSOR_POSITION	19
+#define DEW_CURSOR_POSITION		0
+#define AH_CURSOR_POSITION		12
+#define LOGGER_CURSOR_POSITION	9
+
+
+/*  bStatsPage: temperature/humidity x today/yesterday  */
+#define STATS_PAGE_HUMIDITY		1		// bit 0
+#define STATS_PAGE_YESTERDAY	2		// bit 1
+#define NUMBER_OF_STATS_PAGES	4
+
+
+/*  bIdleView  */
+#define IDLE_VIEW_MEASURES		0		// temperature and relative humidity
+#define IDLE_VIEW_DERIVED		1		// dew point and absolute humidity
+#define IDLE_VIEW_TREND			2		// sparklines of the last samples
+#define NUMBER_OF_IDLE_VIEWS	3
+
+/* Trend view: TREND_GLYPHS custom characters per channel, CGRAM 0..3 temperature, 4..7 humidity */
+#define TREND_TEMP_CURSOR_POSITION	0
+#define TREND_HUM_CURSOR_POSITION	8
+#define TREND_TEMP_GLYPH			0
+#define TREND_HUM_GLYPH				TREND_GLYPHS
+
+
+/*  Screen state, SENSE_ui.c  */
+extern volatile uint8_t bTimeChanged;
+extern volatile uint8_t bDateChanged;
+extern volatile uint8_t bTempChanged;
+extern volatile uint8_t bHumChanged;
+extern volatile uint8_t bDerivedChanged;
+extern volatile uint8_t bSelectionMenu;
+extern volatile uint8_t bSelectionMenuChanged;
+extern volatile uint8_t bTimeCommaState;
+extern uint8_t bColonChanged;
+extern uint8_t bLoggerChanged;
+extern volatile uint8_t bIdleView;
+extern uint8_t bTrendChanged;
+extern uint8_t bLoggerShown;
+extern uint8_t bStatsPage;
+extern uint8_t bStatsChanged;
+
+extern const screen_field sfMenu[] PROGMEM;
+extern const screen_field sfStats[] PROGMEM;
+extern const screen_field sfStatsDetail[] PROGMEM;
+extern const editor_desc edDate[] PROGMEM;
+extern const editor_desc edTime[] PROGMEM;
+extern const editor_desc edHumOn[] PROGMEM;
+extern const editor_desc edHumAl[] PROGMEM;
+extern const editor_desc edLogInterval[] PROGMEM;
+extern const editor_desc edLogMode[] PROGMEM;
+extern uint16_t waLogIntervals[NUMBER_OF_LOG_INTERVALS];
+
+/*  Application data shown and edited by the screens, SENSE.c  */
+extern volatile int16_t iaChannelValue[ADC_NUMBER_OF_CHANNELS];
+extern volatile int16_t iDewPoint;
+extern volatile uint16_t wAbsHumidity;
+extern trend_history thTemp;
+extern trend_history thHum;
+extern running_stats rsHumToday;
+extern running_stats rsTempToday;
+extern running_stats rsHumYesterday;
+extern running_stats rsTempYesterday;
+extern volatile uint8_t bHumOnThreshold;
+extern volatile uint8_t bHumAlarmThreshold;
+extern volatile uint16_t wLogInterval;
+extern volatile uint8_t bLogMode;
+
+
+/*  SENSE_ui.c  */
+void refreshQuote(void);
+void invalidateIdleScreen(void);
+uint8_t isIdleScreenPending(void);
+void toggleTimeColon(void);
+uint8_t loadTrendGlyphs(void);
+void printIdleLCD(void);
+void fmtDate(char *dst);
+void fmtLogger(char *dst);
+void fmtHour(char *dst);
+void fmtColon(char *dst);
+void fmtMinute(char *dst);
+void fmtTemperature(char *dst);
+void fmtHumidity(char *dst);
+void fmtDewPoint(char *dst);
+void fmtAbsHumidity(char *dst);
+void fmtTrendTemp(char *dst);
+void fmtTrendHum(char *dst);
+void fmtMenuSelected(char *dst);
+void fmtMenuNext(char *dst);
+void fmtStatsTitle(char *dst);
+void fmtStatsMean(char *dst);
+void fmtStatsMin(char *dst);
+void fmtStatsMax(char *dst);
+void fmtStatsDev(char *dst);
+void fmtStatsMinTime(char *dst);
+void fmtStatsMaxTime(char *dst);
+void loadDate(uint8_t *values, char *line);
+void commitDate(const uint8_t *values);
+uint8_t maxDay(const uint8_t *values);
+void loadTime(uint8_t *values, char *line);
+void commitTime(const uint8_t *values);
+void loadHumOnTh(uint8_t *values, char *line);
+void commitHumOnTh(const uint8_t *values);
+void loadHumAlTh(uint8_t *values, char *line);
+void commitHumAlTh(const uint8_t *values);
+void loadLogInterval(uint8_t *values, char *line);
+void commitLogInterval(const uint8_t *values);
+void fmtLogIntervalValue(char *dst, uint8_t value);
+void loadLogMode(uint8_t *values, char *line);
+void commitLogMode(const uint8_t *values);
+void fmtLogModeValue(char *dst, uint8_t value);
+uint8_t getLogIntervalIndex(uint16_t interval);
+
+/*  SENSE.c  */
+void getTime(time_date *t);
+void setTime(time_date *t);
+void vNewDay(void);
+void vLogSettingsChanged(uint8_t setting);
+
+#endif // SENSE_UI_H_
@@ -115,6 +115,40 @@ uint8_t EEPROM_writeByte(uint32_t address, uint8_t src){
 }
 
 
+uint8_t EEPROM_writeChunk( uint32_t address, uint8_t * src, uint8_t length ){
+	
+	uint8_t errorStatus=0, page, highAddress, lowAddress, slaveAddress, room, i;
+	page = address >> 16;
+	highAddress = address >> 8;
+	lowAddress = address;
+	
+	room = EEPROM_PAGESIZE - (address % EEPROM_PAGESIZE);		// the chip wraps inside the page
+	if(length > room) length = room;
+	
+	slaveAddress = SLA;
+	#ifdef EEPROM_EXTENDED_SIZE
+	  if(page!=0){				// addressing a byte inside first page
+		  slaveAddress += PAGE_1;
+	  }
+	#endif
+	
+	if((i2c_start_address(slaveAddress+W))!=0){		// NACK: write cycle still in progress
+		i2c_stop();
+		return 0;
+	}
+	errorStatus |= i2c_sendData_ACK(highAddress);
+	errorStatus |= i2c_sendData_ACK(lowAddress);
+	
+	for(i=0; (i<length)&&(!errorStatus); i++)
+		errorStatus |= i2c_sendData_ACK(*src++);
+	
+	i2c_stop();					// starts the write cycle: no delay here
+	
+	if(errorStatus) return 0;
+	return length;
+}
+
+
 uint8_t EEPROM_writeData( uint32_t address, uint8_t * bpData, uint8_t length ){
 	uint8_t i;
 	
@@ -96,4 +96,25 @@ uint8_t EEPROM_sequentialRead( uint32_t address, uint32_t numOfBytes, uint8_t *
 uint8_t EEPROM_sequentialWrite( uint32_t address, uint32_t numOfBytes, uint8_t * src);
 uint32_t EEPROM_erase( uint32_t sizeKbit );
 
+
+/****************************************************************
+ Public Function: EEPROM_writeChunk
+
+ Purpose: Non blocking write: a single I2C transaction of up to LENGTH
+		bytes, stopped at the page boundary, without waiting for the
+		write cycle. While the chip is busy with the previous cycle it
+		does not acknowledge its address, so the call just returns 0
+		and has to be repeated later (acknowledge polling).
+
+ Input Parameter:
+ 	- uint32_t		Address of the first byte
+ 	- uint8_t *		Source
+ 	- uint8_t		Number of bytes
+
+ Return Value: uint8_t
+	- Number of bytes written (0: chip busy or bus error).
+
+*****************************************************************/
+uint8_t EEPROM_writeChunk( uint32_t address, uint8_t * src, uint8_t length );
+
 #endif // EEPROM_H_
\ No newline at end of file
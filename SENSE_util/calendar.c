@@ -0,0 +1,63 @@
+/**
+ * \file calendar.c
+ * \brief Day number <--> calendar date conversion, main file.
+ */
+
+#include <avr/pgmspace.h>
+#include "calendar.h"
+
+
+/// Days of the months, February of a common year.
+const uint8_t baMonthDays[12] PROGMEM = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+
+/// Day of the year (0 based) of the first of every month, common year.
+const uint16_t waMonthStart[12] PROGMEM = { 0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334 };
+
+
+uint8_t cal_isLeapYear( uint8_t year ){
+	return (year & 3) == 0;		// 2000 is a leap year, 2100 is out of range
+}
+
+
+/// \a month 1..12.
+uint8_t cal_daysInMonth( uint8_t month, uint8_t year ){
+	if(( month == 2 )&&( cal_isLeapYear(year) )) return 29;
+	return pgm_read_byte(&baMonthDays[month-1]);
+}
+
+
+/// Days from 01/01/2000 to the given date; \a month 1..12, \a day 1..31.
+uint16_t cal_dayNumber( uint8_t day, uint8_t month, uint8_t year ){
+	uint16_t wDays;
+	
+	wDays = (uint16_t)(year >> 2) * CAL_DAYS_PER_CYCLE;
+	if( year & 3 ) wDays += 366 + (uint16_t)((year & 3) - 1) * 365;		// the first year of the cycle is leap
+	wDays += pgm_read_word(&waMonthStart[month-1]);
+	if(( month > 2 )&&( cal_isLeapYear(year) )) wDays++;
+	return wDays + day - 1;
+}
+
+
+void cal_fromDayNumber( uint16_t days, uint8_t *day, uint8_t *month, uint8_t *year ){
+	uint8_t bYear, bMonth, bLeap;
+	uint16_t wStart;
+	
+	bYear = (days / CAL_DAYS_PER_CYCLE) * 4;
+	days %= CAL_DAYS_PER_CYCLE;
+	if( days >= 366 ){				// past the leap year of the cycle
+		days -= 366;
+		bYear += 1 + days / 365;
+		days %= 365;
+	}
+	
+	bLeap = cal_isLeapYear(bYear);
+	for(bMonth=11; bMonth>0; bMonth--){
+		wStart = pgm_read_word(&waMonthStart[bMonth]) + ((bLeap && bMonth >= 2)?1:0);
+		if( days >= wStart ) break;
+	}
+	if( bMonth == 0 ) wStart = 0;
+	
+	*day = days - wStart + 1;
+	*month = bMonth + 1;
+	*year = bYear;
+}
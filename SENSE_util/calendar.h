@@ -0,0 +1,37 @@
+/**
+ * \file calendar.h
+ * \brief Day number <--> calendar date conversion, header file.
+ *
+ * Days are counted from 01/01/2000 (day 0); years are two digits, 00..99.
+ * Every year divisible by 4 is a leap year in this range, so the conversion
+ * works on 4 year cycles of 1461 days plus a month table kept in flash.
+ */
+
+#ifndef CALENDAR_H_
+#define CALENDAR_H_
+
+#include <stdint.h>
+
+#define CAL_SECS_PER_DAY		86400UL
+#define CAL_DAYS_PER_CYCLE		1461		///< Days of a 4 year cycle, first year leap.
+
+/**
+ * \brief Calendar fields of the RTC, as read by getTime().
+ */
+typedef struct{
+	uint16_t wMilli;
+	uint8_t bSec;
+	uint8_t bMin;
+	uint8_t bHour;
+	uint8_t bDay;
+	uint8_t bMonth;
+	uint8_t bYear;
+} time_date;
+
+
+uint8_t cal_isLeapYear( uint8_t year );
+uint8_t cal_daysInMonth( uint8_t month, uint8_t year );
+uint16_t cal_dayNumber( uint8_t day, uint8_t month, uint8_t year );
+void cal_fromDayNumber( uint16_t days, uint8_t *day, uint8_t *month, uint8_t *year );
+
+#endif // CALENDAR_H_
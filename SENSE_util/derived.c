@@ -0,0 +1,87 @@
+/**
+ * \file derived.c
+ * \brief Derived humidity metrics (dew point, absolute humidity), main file.
+ *
+ * Worst case cost: a 7 step binary search, two 32 bit divisions and a few
+ * multiplications, so it can run inside the ADC interrupt after every sample.
+ */
+
+#include <avr/pgmspace.h>
+#include "derived.h"
+
+
+/// Saturation vapour pressure over water (Pa) from DERIVED_T_MIN to DERIVED_T_MAX, 1 degC step (Magnus, 17.62/243.12).
+const uint16_t waSaturationPressure[DERIVED_TABLE_SIZE] PROGMEM = {
+	  126,   137,   149,   163,   177,   192,   208,   226,   245,   265,
+	  287,   310,   336,   363,   391,   422,   455,   490,   528,   568,
+	  611,   657,   706,   758,   813,   872,   934,  1001,  1071,  1146,
+	 1226,  1310,  1400,  1495,  1595,  1702,  1814,  1933,  2059,  2192,
+	 2333,  2481,  2637,  2803,  2977,  3160,  3353,  3557,  3771,  3997,
+	 4234,  4483,  4745,  5020,  5309,  5613,  5931,  6265,  6616,  6983,
+	 7367,  7770,  8192,  8634,  9096,  9580, 10085, 10614, 11166, 11743,
+	12345, 12974, 13630, 14315, 15029, 15774, 16550, 17359, 18202, 19080,
+	19993
+};
+
+
+/// Saturation vapour pressure (Pa) at \a temperature (0.1 degC), clamped to the table range.
+uint16_t derived_saturationPressure( int16_t temperature ){
+	uint8_t i, frac;
+	uint16_t wLow, wHigh;
+	
+	if( temperature <= DERIVED_T_MIN*10 ) return pgm_read_word(&waSaturationPressure[0]);
+	if( temperature >= DERIVED_T_MAX*10 ) return pgm_read_word(&waSaturationPressure[DERIVED_TABLE_SIZE-1]);
+	
+	temperature -= DERIVED_T_MIN*10;
+	i = temperature / 10;
+	frac = temperature % 10;
+	
+	wLow = pgm_read_word(&waSaturationPressure[i]);
+	wHigh = pgm_read_word(&waSaturationPressure[i+1]);
+	
+	return wLow + ((wHigh - wLow) * frac + 5) / 10;
+}
+
+
+/// Actual vapour pressure (Pa) for \a humidity (0.1 %RH) at \a temperature (0.1 degC).
+uint16_t derived_vapourPressure( int16_t temperature, int16_t humidity ){
+	if( humidity <= 0 ) return 0;
+	if( humidity > 1000 ) humidity = 1000;
+	
+	return ((uint32_t)derived_saturationPressure(temperature) * humidity + 500) / 1000;
+}
+
+
+/// Dew point (0.1 degC): temperature at which the actual vapour pressure saturates.
+int16_t derived_dewPoint( int16_t temperature, int16_t humidity ){
+	uint16_t wE, wLow, wHigh;
+	uint8_t bLo, bHi, bMid;
+	
+	wE = derived_vapourPressure(temperature, humidity);
+	
+	if( wE <= pgm_read_word(&waSaturationPressure[0]) ) return DERIVED_T_MIN*10;
+	if( wE >= pgm_read_word(&waSaturationPressure[DERIVED_TABLE_SIZE-1]) ) return DERIVED_T_MAX*10;
+	
+	bLo = 0;									// table[bLo] < wE <= table[bHi]
+	bHi = DERIVED_TABLE_SIZE-1;
+	while( bHi - bLo > 1 ){
+		bMid = (bLo + bHi) >> 1;
+		if( pgm_read_word(&waSaturationPressure[bMid]) < wE ) bLo = bMid;
+		else bHi = bMid;
+	}
+	
+	wLow = pgm_read_word(&waSaturationPressure[bLo]);
+	wHigh = pgm_read_word(&waSaturationPressure[bHi]);
+	
+	return (DERIVED_T_MIN + bLo)*10 + (int16_t)(((uint32_t)(wE - wLow) * 10 + ((wHigh - wLow) >> 1)) / (wHigh - wLow));
+}
+
+
+/// Absolute humidity (0.1 g/m^3): AH = e / (Rv * T) = 2.1668 * e[Pa] / T[K].
+uint16_t derived_absHumidity( int16_t temperature, int16_t humidity ){
+	uint32_t lKelvin;
+	
+	lKelvin = (int32_t)temperature + 2732;		// tenths of K
+	
+	return ((uint32_t)derived_vapourPressure(temperature, humidity) * 21668UL + lKelvin*50) / (lKelvin*100);
+}
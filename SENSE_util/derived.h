@@ -0,0 +1,26 @@
+/**
+ * \file derived.h
+ * \brief Derived humidity metrics (dew point, absolute humidity), header file.
+ *
+ * Fixed-point replacement for the Magnus formulas: the saturation vapour pressure
+ * is read from a 1 degC table kept in flash and linearly interpolated, the dew point
+ * is found by inverse lookup in the same table. No log()/exp() is ever called.
+ * Temperatures and humidities are int16_t in tenths of unit (0.1 degC, 0.1 %RH).
+ */
+
+#ifndef DERIVED_H_
+#define DERIVED_H_
+
+#include <stdint.h>
+
+#define DERIVED_T_MIN		-20			///< First temperature of the vapour pressure table (degC).
+#define DERIVED_T_MAX		60			///< Last temperature of the vapour pressure table (degC).
+#define DERIVED_TABLE_SIZE	(DERIVED_T_MAX-DERIVED_T_MIN+1)
+
+
+uint16_t derived_saturationPressure( int16_t temperature );
+uint16_t derived_vapourPressure( int16_t temperature, int16_t humidity );
+int16_t derived_dewPoint( int16_t temperature, int16_t humidity );
+uint16_t derived_absHumidity( int16_t temperature, int16_t humidity );
+
+#endif // DERIVED_H_
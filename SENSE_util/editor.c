@@ -0,0 +1,101 @@
+/**
+ * \file editor.c
+ * \brief Table driven value editor, main file.
+ */
+
+#include <avr/pgmspace.h>
+#include "editor.h"
+#include "lcd.h"
+#include "format.h"
+
+
+static editor_desc edOpen;						///< Copy of the descriptor being edited.
+static uint8_t baEditValues[EDITOR_MAX_FIELDS];
+static uint8_t bEditField;							///< Selected field.
+
+
+static void vEditLoadField( uint8_t j, edit_field *ef ){
+	memcpy_P(ef, &edOpen.pFields[j], sizeof(edit_field));
+	if( ef->fMax ) ef->bMax = ef->fMax(baEditValues);
+}
+
+static void vEditDrawField( uint8_t j ){
+	edit_field efField;
+	char caText[LCD_COLS+1];
+	uint8_t n = 0;
+	
+	vEditLoadField(j, &efField);
+	if( efField.fFormat ) efField.fFormat(caText, baEditValues[j]);
+	else fmt_u2(caText, baEditValues[j]);
+	LCDGotoXY(efField.bX, 1);
+	while( caText[n] && n < efField.bWidth ) LCDWriteChar(caText[n++]);
+}
+
+static void vEditPlaceCursor( void ){
+	edit_field efField;
+	
+	memcpy_P(&efField, &edOpen.pFields[bEditField], sizeof(edit_field));
+	LCDGotoXY(efField.bX + efField.bWidth - 1, 1);
+}
+
+
+/**
+ * \brief Loads the setting and draws the whole editor on a clear screen.
+ */
+void editor_open( const editor_desc *ed ){
+	char caLine[LCD_COLS+1];
+	uint8_t j;
+	
+	memcpy_P(&edOpen, ed, sizeof(editor_desc));
+	bEditField = 0;
+	caLine[0] = '\0';
+	edOpen.fLoad(baEditValues, caLine);
+	
+	LCDClear();
+	LCDWriteStringXY_P(0,0, edOpen.pTitle);
+	LCDWriteStringXY(0,1, caLine);
+	for(j=0; j<edOpen.bCount; j++) vEditDrawField(j);
+	vEditPlaceCursor();
+}
+
+
+/**
+ * \brief Up (\a dir > 0) or down the selected field by its step.
+ *
+ * The bounds of the other fields can depend on it (the days of the month):
+ * values left out of range are clamped and redrawn.
+ */
+void editor_step( int8_t dir ){
+	edit_field efField;
+	uint8_t v, j;
+	
+	vEditLoadField(bEditField, &efField);
+	v = baEditValues[bEditField];
+	if( dir > 0 ){
+		if( v > efField.bMax - efField.bStep ) v = (efField.bWrap)?efField.bMin:efField.bMax;
+		else v += efField.bStep;
+	}else{
+		if( v < efField.bMin + efField.bStep ) v = (efField.bWrap)?efField.bMax:efField.bMin;
+		else v -= efField.bStep;
+	}
+	baEditValues[bEditField] = v;
+	
+	for(j=0; j<edOpen.bCount; j++){
+		vEditLoadField(j, &efField);
+		if( baEditValues[j] > efField.bMax ) baEditValues[j] = efField.bMax;
+		vEditDrawField(j);				// framebuffer: the unchanged fields cost nothing on the bus
+	}
+	vEditPlaceCursor();
+}
+
+
+/// Selects the following field, the first one after the last.
+void editor_next( void ){
+	if( ++bEditField >= edOpen.bCount ) bEditField = 0;
+	vEditPlaceCursor();
+}
+
+
+void editor_commit( void ){
+	edOpen.fCommit(baEditValues);
+}
@@ -0,0 +1,54 @@
+/**
+ * \file editor.h
+ * \brief Table driven value editor, header file.
+ *
+ * A setting is edited as a row of small numeric fields on the second line of
+ * the LCD (day/month/year, a threshold, an index into a table of choices...).
+ * The editor descriptor gives the title, how to load the current setting,
+ * how to commit the edited one and the PROGMEM table of the fields: position,
+ * width, range, step and wrap. Up/down change the selected field, next moves
+ * to the following one; the cursor always sits on the last character of the
+ * selected field.
+ */
+
+#ifndef EDITOR_H_
+#define EDITOR_H_
+
+#include <stdint.h>
+
+#define EDITOR_MAX_FIELDS		3
+#define EDITOR_FIELDS(table)	(sizeof(table)/sizeof((table)[0]))
+
+
+/**
+ * \brief One editable field of the second line.
+ */
+typedef struct{
+	uint8_t		bX;										///< First column of the field.
+	uint8_t		bWidth;									///< Characters written by fFormat.
+	uint8_t		bMin;
+	uint8_t		bMax;
+	uint8_t		bStep;
+	uint8_t		bWrap;									///< 1: past a bound the value restarts from the other one.
+	uint8_t		(*fMax)(const uint8_t *values);			///< Upper bound depending on the other fields, NULL --> bMax.
+	void		(*fFormat)(char *dst, uint8_t value);	///< Text of the value, NULL --> two digits.
+} edit_field;
+
+/**
+ * \brief A setting: title, load/commit callbacks and its fields.
+ */
+typedef struct{
+	const char			*pTitle;							///< PROGMEM, first line.
+	void				(*fLoad)(uint8_t *values, char *line);	///< Current setting --> values, fixed text of the second line.
+	void				(*fCommit)(const uint8_t *values);
+	const edit_field	*pFields;							///< PROGMEM table, at most EDITOR_MAX_FIELDS.
+	uint8_t				bCount;
+} editor_desc;
+
+
+void editor_open( const editor_desc *ed );
+void editor_step( int8_t dir );
+void editor_next( void );
+void editor_commit( void );
+
+#endif // EDITOR_H_
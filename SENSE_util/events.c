@@ -0,0 +1,97 @@
+/**
+ * \file events.c
+ * \brief Event queue for the cooperative scheduler, main file.
+ *
+ * event_post() and button_post() must be called from interrupt context (or
+ * with interrupts disabled), event_get() and button_get() from the main loop
+ * only.
+ */
+
+#include "events.h"
+
+
+static volatile event evaQueue[EVENT_QUEUE_SIZE];
+static volatile uint8_t bEvHead;				///< Next free slot, written by the producers.
+static volatile uint8_t bEvTail;				///< Oldest event, written by the consumer.
+static volatile uint8_t bEvOverflows;			///< Events dropped because the queue was full.
+
+static volatile button_event beaRing[BUTTON_RING_SIZE];
+static volatile uint8_t bBtnHead;
+static volatile uint8_t bBtnTail;
+static volatile uint8_t bBtnOverflows;			///< Presses dropped because the ring was full.
+
+
+/// Returns 0 and counts an overflow when the queue is full.
+uint8_t event_post( uint8_t type, uint8_t data ){
+	uint8_t bNext = (bEvHead + 1) & EVENT_QUEUE_MASK;
+	
+	if( bNext == bEvTail ){
+		if( bEvOverflows < 0xFF ) bEvOverflows++;
+		return 0;
+	}
+	evaQueue[bEvHead].bType = type;
+	evaQueue[bEvHead].bData = data;
+	bEvHead = bNext;				// publish only after the slot is filled
+	return 1;
+}
+
+
+/// Copies the oldest event into \a ev; returns 0 when the queue is empty.
+uint8_t event_get( event *ev ){
+	uint8_t bTail = bEvTail;
+	
+	if( bTail == bEvHead ) return 0;
+	ev->bType = evaQueue[bTail].bType;
+	ev->bData = evaQueue[bTail].bData;
+	bEvTail = (bTail + 1) & EVENT_QUEUE_MASK;		// release the slot only after reading it
+	return 1;
+}
+
+
+uint8_t event_pending( void ){
+	return bEvHead != bEvTail;
+}
+
+
+uint8_t event_overflows( void ){
+	return bEvOverflows;
+}
+
+
+/// Returns 0 and counts an overflow when the ring is full.
+uint8_t button_post( uint8_t code, uint16_t stamp, uint16_t duration ){
+	uint8_t bNext = (bBtnHead + 1) & BUTTON_RING_MASK;
+	
+	if( bNext == bBtnTail ){
+		if( bBtnOverflows < 0xFF ) bBtnOverflows++;
+		return 0;
+	}
+	beaRing[bBtnHead].bCode = code;
+	beaRing[bBtnHead].wStamp = stamp;
+	beaRing[bBtnHead].wDuration = duration;
+	bBtnHead = bNext;
+	return 1;
+}
+
+
+/// Copies the oldest press into \a be; returns 0 when the ring is empty.
+uint8_t button_get( button_event *be ){
+	uint8_t bTail = bBtnTail;
+	
+	if( bTail == bBtnHead ) return 0;
+	be->bCode = beaRing[bTail].bCode;
+	be->wStamp = beaRing[bTail].wStamp;
+	be->wDuration = beaRing[bTail].wDuration;
+	bBtnTail = (bTail + 1) & BUTTON_RING_MASK;
+	return 1;
+}
+
+
+uint8_t button_pending( void ){
+	return bBtnHead != bBtnTail;
+}
+
+
+uint8_t button_overflows( void ){
+	return bBtnOverflows;
+}
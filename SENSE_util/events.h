@@ -0,0 +1,52 @@
+/**
+ * \file events.h
+ * \brief Event queue for the cooperative scheduler, header file.
+ *
+ * Interrupts post small typed events, the main loop takes them out in arrival
+ * order and runs the matching handler to completion.
+ * AVR interrupts do not nest, so the producers never preempt each other: head
+ * is only written by them and tail only by the consumer, both single byte, and
+ * the queue needs no locking.
+ *
+ * Button presses have a ring of their own, carrying when the press was
+ * recognised and how long the key was held: it is drained one press per main
+ * loop pass, so nothing is lost while the main loop is busy writing EEPROM.
+ */
+
+#ifndef EVENTS_H_
+#define EVENTS_H_
+
+#include <stdint.h>
+
+#define EVENT_QUEUE_SIZE	16			///< Must be a power of two.
+#define EVENT_QUEUE_MASK	(EVENT_QUEUE_SIZE-1)
+
+#define EV_NONE				0
+
+#define BUTTON_RING_SIZE	8			///< Must be a power of two.
+#define BUTTON_RING_MASK	(BUTTON_RING_SIZE-1)
+
+
+typedef struct{
+	uint8_t bType;			///< EV_* code, defined by the application.
+	uint8_t bData;			///< Event payload, its meaning depends on bType.
+} event;
+
+typedef struct{
+	uint8_t bCode;			///< Button code, defined by the application.
+	uint16_t wStamp;		///< Tick counter when the press was recognised.
+	uint16_t wDuration;		///< Ticks the key has been held down.
+} button_event;
+
+
+uint8_t event_post( uint8_t type, uint8_t data );
+uint8_t event_get( event *ev );
+uint8_t event_pending( void );
+uint8_t event_overflows( void );
+
+uint8_t button_post( uint8_t code, uint16_t stamp, uint16_t duration );
+uint8_t button_get( button_event *be );
+uint8_t button_pending( void );
+uint8_t button_overflows( void );
+
+#endif // EVENTS_H_
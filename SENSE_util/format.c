@@ -0,0 +1,132 @@
+/**
+ * \file format.c
+ * \brief Integer formatters for the display, main file.
+ */
+
+#include <avr/pgmspace.h>
+#include "format.h"
+
+
+char *fmt_str( char *dst, const char *s ){
+	while( *s ) *dst++ = *s++;
+	*dst = '\0';
+	return dst;
+}
+
+
+/// Same as fmt_str(), s in program memory.
+char *fmt_str_P( char *dst, const char *s ){
+	char c;
+	
+	while(( c = pgm_read_byte(s++) )) *dst++ = c;
+	*dst = '\0';
+	return dst;
+}
+
+
+char *fmt_char( char *dst, char c ){
+	*dst++ = c;
+	*dst = '\0';
+	return dst;
+}
+
+
+/// Two digits, zero padded: "%02d" for 0..99.
+char *fmt_u2( char *dst, uint8_t value ){
+	uint8_t bTens = 0;
+	
+	while( value >= 10 ){ value -= 10; bTens++; }
+	dst[0] = '0' + (bTens % 10);
+	dst[1] = '0' + value;
+	dst[2] = '\0';
+	return dst+2;
+}
+
+
+/// Right aligned in width characters, padded with pad (' ' or '0'): "%5u", "%05u".
+char *fmt_uint( char *dst, uint16_t value, uint8_t width, char pad ){
+	char caDigits[5];
+	uint8_t n = 0;
+	
+	do{
+		caDigits[n++] = '0' + (value % 10);
+		value /= 10;
+	}while( value );
+	while( width > n ){ *dst++ = pad; width--; }
+	while( n ) *dst++ = caDigits[--n];
+	*dst = '\0';
+	return dst;
+}
+
+
+/// As fmt_uint(), 32 bit: counters of the diagnostics only (32 bit divisions are slow).
+char *fmt_ulong( char *dst, uint32_t value, uint8_t width, char pad ){
+	char caDigits[10];
+	uint8_t n = 0;
+	
+	do{
+		caDigits[n++] = '0' + (value % 10);
+		value /= 10;
+	}while( value );
+	while( width > n ){ *dst++ = pad; width--; }
+	while( n ) *dst++ = caDigits[--n];
+	*dst = '\0';
+	return dst;
+}
+
+
+/**
+ * \brief Value in tenths with one decimal, right aligned: "%5.1f", "%04.1f".
+ *
+ * With pad '0' the sign goes before the zeros, as printf does.
+ */
+char *fmt_fixed1( char *dst, int16_t tenths, uint8_t width, char pad ){
+	char caDigits[6];
+	uint16_t wAbs = (tenths < 0) ? -tenths : tenths;
+	uint8_t n = 0;
+	uint8_t bLength;
+	
+	caDigits[n++] = '0' + (wAbs % 10);
+	caDigits[n++] = '.';
+	wAbs /= 10;
+	do{
+		caDigits[n++] = '0' + (wAbs % 10);
+		wAbs /= 10;
+	}while( wAbs );
+	
+	bLength = n + ((tenths < 0) ? 1 : 0);
+	if( tenths < 0 && pad == '0' ) *dst++ = '-';
+	while( width > bLength ){ *dst++ = pad; width--; }
+	if( tenths < 0 && pad != '0' ) *dst++ = '-';
+	while( n ) *dst++ = caDigits[--n];
+	*dst = '\0';
+	return dst;
+}
+
+
+/// "dd/mm/yy"
+char *fmt_date( char *dst, uint8_t day, uint8_t month, uint8_t year ){
+	dst = fmt_u2(dst, day);
+	*dst++ = '/';
+	dst = fmt_u2(dst, month);
+	*dst++ = '/';
+	return fmt_u2(dst, year);
+}
+
+
+/// "hh:mm:ss"
+char *fmt_time( char *dst, uint8_t hour, uint8_t min, uint8_t sec ){
+	dst = fmt_u2(dst, hour);
+	*dst++ = ':';
+	dst = fmt_u2(dst, min);
+	*dst++ = ':';
+	return fmt_u2(dst, sec);
+}
+
+
+/// Minutes as "HHhMM" (up to 99h59).
+char *fmt_hm( char *dst, uint16_t minutes ){
+	dst = fmt_u2(dst, minutes / 60);
+	*dst++ = 'h';
+	return fmt_u2(dst, minutes % 60);
+}
@@ -0,0 +1,32 @@
+/**
+ * \file format.h
+ * \brief Integer formatters for the display, header file.
+ *
+ * Small replacements for the sprintf() calls of the display path: fixed
+ * width fields from integers and from values scaled by 10, no float and no
+ * vfprintf. Every function writes at dst, terminates the string and returns
+ * the position of the terminator, so fields can be chained:
+ * \code
+ * p = fmt_str_P(str, PSTR("p:"));
+ * p = fmt_u2(p, bValue);
+ * \endcode
+ */
+
+#ifndef FORMAT_H_
+#define FORMAT_H_
+
+#include <stdint.h>
+
+
+char *fmt_str( char *dst, const char *s );
+char *fmt_str_P( char *dst, const char *s );
+char *fmt_char( char *dst, char c );
+char *fmt_u2( char *dst, uint8_t value );
+char *fmt_uint( char *dst, uint16_t value, uint8_t width, char pad );
+char *fmt_ulong( char *dst, uint32_t value, uint8_t width, char pad );
+char *fmt_fixed1( char *dst, int16_t tenths, uint8_t width, char pad );
+char *fmt_date( char *dst, uint8_t day, uint8_t month, uint8_t year );
+char *fmt_time( char *dst, uint8_t hour, uint8_t min, uint8_t sec );
+char *fmt_hm( char *dst, uint16_t minutes );
+
+#endif // FORMAT_H_
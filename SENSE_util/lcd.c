@@ -12,6 +12,8 @@
 */
 
 #include <inttypes.h>
+#include <string.h>
+#include <avr/pgmspace.h>
 #include "lcd.h"
 
 
@@ -45,6 +47,31 @@
 #define CLEAR_RW() (LCD_RW_PORT&=(~(1<<LCD_RW_POS)))
 
 
+/*
+	Shadow framebuffer: LCDWriteString(), LCDGotoXY() & co. only draw into caLcdFrame[]
+	and move a software cursor. LCDFlush() sends the cells that differ from caLcdShown[]
+	(what the controller is displaying); consecutive changed cells go out with a single
+	address command, since the HD44780 increments the address after every data byte.
+*/
+static char caLcdFrame[LCD_ROWS][LCD_COLS];		// what the application wants on the display
+static char caLcdShown[LCD_ROWS][LCD_COLS];		// what the LCD is showing
+static uint8_t bLcdX, bLcdY;					// software cursor
+static uint8_t bLcdHwX, bLcdHwY;				// DDRAM address of the controller
+static uint8_t bLcdDirty;						// caLcdFrame[] written since the last flush
+
+static const uint8_t baLcdRowAddress[4]={ 0x00, 0x40, 0x14, 0x54 };
+static uint8_t baLcdCgram[8][8];				// custom characters as sent to the CGRAM
+
+/*
+	Transmit queue: LCDCmd()/LCDData() only enqueue (bit 8 set = data), LCDTask() sends one
+	entry per call, after a single read of the busy flag. Written and drained by the main loop.
+*/
+static uint16_t waLcdTx[LCD_TX_SIZE];
+static uint8_t bLcdTxHead, bLcdTxTail;			// write / read indexes, free running
+
+static void LCDSend(uint8_t c,uint8_t isdata);
+
+
 
 void LCDByte(uint8_t c,uint8_t isdata)
 {
@@ -55,6 +82,14 @@ void LCDByte(uint8_t c,uint8_t isdata)
 
 	//NOTE: THIS FUNCTION RETURS ONLY WHEN LCD HAS PROCESSED THE COMMAND
 
+	LCDSend(c,isdata);
+	LCDBusyLoop();
+}
+
+static void LCDSend(uint8_t c,uint8_t isdata)
+{
+	//Sends a byte to the LCD in 4bit mode, without waiting for it to be processed
+
 	uint8_t hn,ln;			//Nibbles
 	uint8_t temp;
 
@@ -97,15 +132,20 @@ void LCDByte(uint8_t c,uint8_t isdata)
 	CLEAR_E();
 
 	_delay_us(ONE);			//tEL
-
-	LCDBusyLoop();
 }
 
 void LCDBusyLoop()
 {
 	//This function waits till lcd is BUSY
 
-	uint8_t busy,status=0x00,temp;
+	while(LCDIsBusy());
+}
+
+uint8_t LCDIsBusy()
+{
+	//Reads the busy flag once: 1 if the LCD is still executing the last instruction
+
+	uint8_t status=0x00,temp;
 
 	//Change Port to input type because we are reading data
 	LCD_DATA_DDR&=0xF0;
@@ -117,43 +157,38 @@ void LCDBusyLoop()
 	//Let the RW/RS lines stabilize
 
 	_delay_us(HALF);		//tAS
-	
-	do
-	{
 
-		SET_E();
-
-		//Wait tDA for data to become available
-		_delay_us(HALF);
+	SET_E();
 
-		status=LCD_DATA_PIN;
-		status=status<<4;
+	//Wait tDA for data to become available
+	_delay_us(HALF);
 
-		_delay_us(HALF);
+	status=LCD_DATA_PIN;
+	status=status<<4;
 
-		//Pull E low
-		CLEAR_E();
-		_delay_us(ONE);	//tEL
+	_delay_us(HALF);
 
-		SET_E();
-		_delay_us(HALF);
+	//Pull E low
+	CLEAR_E();
+	_delay_us(ONE);	//tEL
 
-		temp=LCD_DATA_PIN;
-		temp&=0x0F;
+	SET_E();
+	_delay_us(HALF);
 
-		status=status|temp;
+	temp=LCD_DATA_PIN;
+	temp&=0x0F;
 
-		busy=status & 0b10000000;
+	status=status|temp;
 
-		_delay_us(HALF);
-		CLEAR_E();
-		_delay_us(ONE);	//tEL
-	}while(busy);
+	_delay_us(HALF);
+	CLEAR_E();
+	_delay_us(ONE);	//tEL
 
 	CLEAR_RW();		//write mode
 	//Change Port to output
 	LCD_DATA_DDR|=0x0F;
 
+	return (status & 0b10000000)?1:0;
 }
 
 void InitLCD(uint8_t style)
@@ -198,8 +233,26 @@ void InitLCD(uint8_t style)
 
 	//Now the LCD is in 4-bit mode
 
-	LCDCmd(0b00001100|style);	//Display On
-	LCDCmd(0b00101000);			//function set 4-bit,2 line 5x7 dot format
+	LCDByte(0b00001100|style,0);	//Display On
+	LCDByte(0b00101000,0);			//function set 4-bit,2 line 5x7 dot format
+	
+	LCDByte(0b00000001,0);			//Clear: the shadow buffer starts in sync with the display
+	memset(caLcdShown, ' ', sizeof(caLcdShown));
+	memset(baLcdCgram, 0xFF, sizeof(baLcdCgram));	//CGRAM is random at power up: not a valid 5 bit row
+	bLcdTxHead=0;
+	bLcdTxTail=0;
+	bLcdHwX=0;
+	bLcdHwY=0;
+	LCDFrameClear();
+}
+
+
+//Sets the DDRAM address of the controller
+static void LCDSetAddress(uint8_t x, uint8_t y)
+{
+	LCDCmd(0b10000000|(baLcdRowAddress[y]+x));
+	bLcdHwX=x;
+	bLcdHwY=y;
 }
 void LCDWriteString(const char *msg)
 {
@@ -215,11 +268,158 @@ void LCDWriteString(const char *msg)
 	*****************************************************************/
  while(*msg!='\0')
  {
-	LCDData(*msg);
+	LCDWriteChar(*msg);
 	msg++;
  }
 }
 
+void LCDWriteString_P(const char *msg)
+{
+	//Same as LCDWriteString(), msg in program memory (PSTR() or a PROGMEM table)
+
+	char c;
+
+	while((c=pgm_read_byte(msg++))!='\0')
+	{
+		LCDWriteChar(c);
+	}
+}
+
+void LCDWriteChar(char c)
+{
+	//Writes a character into the framebuffer at the cursor, which moves right.
+	//Like the DDRAM, the cursor goes on past the last column: those characters are not shown.
+
+	if(bLcdX<LCD_COLS && caLcdFrame[bLcdY][bLcdX]!=c)
+	{
+		caLcdFrame[bLcdY][bLcdX]=c;
+		bLcdDirty=1;
+	}
+	bLcdX++;
+}
+
+void LCDCursorShift(int8_t n)
+{
+	//Moves the cursor n positions on the same row (n<0: left)
+
+	if(n<0 && (uint8_t)(-n)>bLcdX) bLcdX=0;
+	else bLcdX+=n;
+}
+
+void LCDFrameClear(void)
+{
+	memset(caLcdFrame, ' ', sizeof(caLcdFrame));
+	bLcdX=0;
+	bLcdY=0;
+	bLcdDirty=1;
+}
+
+void LCDFlush(void)
+{
+	/*****************************************************************
+	
+	Sends to the LCD only the cells of the framebuffer that changed,
+	then puts the controller cursor where the software cursor is (the
+	editors show it).
+
+	*****************************************************************/
+	uint8_t x,y;
+
+	if(bLcdDirty)
+	{
+		bLcdDirty=0;
+		for(y=0;y<LCD_ROWS;y++)
+		{
+			for(x=0;x<LCD_COLS;x++)
+			{
+				if(caLcdFrame[y][x]==caLcdShown[y][x]) continue;
+				if(LCDTxFree()<2)
+				{
+					bLcdDirty=1;		//queue full: the rest at the next flush
+					return;
+				}
+				if(x!=bLcdHwX || y!=bLcdHwY) LCDSetAddress(x,y);
+				LCDData(caLcdFrame[y][x]);
+				caLcdShown[y][x]=caLcdFrame[y][x];
+				bLcdHwX++;
+			}
+		}
+	}
+	if(bLcdX!=bLcdHwX || bLcdY!=bLcdHwY)
+	{
+		if(bLcdX<40 && LCDTxFree()) LCDSetAddress(bLcdX,bLcdY);
+	}
+}
+
+uint8_t LCDDefineChar(uint8_t code, const uint8_t *rows)
+{
+	/*****************************************************************
+	
+	Defines the custom character code (0..7), 8 rows of 5 pixels,
+	top first. Only the rows that differ from the last definition are
+	queued; consecutive ones share the CGRAM address command.
+	Returns 0, queuing nothing, if the transmit queue has not room for
+	the worst case: call it again later.
+
+	*****************************************************************/
+	uint8_t r,next=0xFF;
+
+	code&=0x07;
+	if(LCDTxFree()<16) return 0;
+	for(r=0;r<8;r++)
+	{
+		if(baLcdCgram[code][r]==rows[r]) continue;
+		if(r!=next) LCDCmd(0b01000000|(code<<3)|r);		//Set CGRAM address
+		LCDData(rows[r]);
+		baLcdCgram[code][r]=rows[r];
+		next=r+1;
+		bLcdHwX=0xFF;		//the DDRAM address is lost: LCDFlush() sets it again
+	}
+	return 1;
+}
+
+void LCDQueue(uint8_t c,uint8_t isdata)
+{
+	//Enqueues a byte for LCDTask(). Only if the queue is full it waits for the LCD.
+
+	while(LCDTxFree()==0)
+	{
+		LCDBusyLoop();
+		LCDTask();
+	}
+	waLcdTx[bLcdTxHead & (LCD_TX_SIZE-1)]=(isdata)?(0x100|c):c;
+	bLcdTxHead++;
+}
+
+uint8_t LCDTask(void)
+{
+	/*****************************************************************
+	
+	Sends the next queued byte if the LCD is ready: one busy flag read,
+	never a wait. Returns the number of bytes still queued.
+
+	*****************************************************************/
+	uint16_t wEntry;
+
+	if(bLcdTxHead==bLcdTxTail) return 0;
+	if(LCDIsBusy()) return bLcdTxHead-bLcdTxTail;
+
+	wEntry=waLcdTx[bLcdTxTail & (LCD_TX_SIZE-1)];
+	LCDSend((uint8_t)wEntry, (wEntry>>8));
+	bLcdTxTail++;
+	return bLcdTxHead-bLcdTxTail;
+}
+
+uint8_t LCDTxPending(void)
+{
+	return bLcdTxHead-bLcdTxTail;
+}
+
+uint8_t LCDTxFree(void)
+{
+	return LCD_TX_SIZE-(uint8_t)(bLcdTxHead-bLcdTxTail);
+}
+
 void LCDWriteInt(int val,unsigned int field_length)
 {
 	/***************************************************************
@@ -246,20 +446,19 @@ void LCDWriteInt(int val,unsigned int field_length)
 	else
 		j=5-field_length;
 
-	if(val<0) LCDData('-');
+	if(val<0) LCDWriteChar('-');
 	for(i=j;i<5;i++)
 	{
-	LCDData(48+str[i]);
+	LCDWriteChar(48+str[i]);
 	}
 }
 void LCDGotoXY(uint8_t x,uint8_t y)
 {
- if(x<40)
+ if(x<40 && y<LCD_ROWS)
  {
-  if(y) x|=0b01000000;
-  x|=0b10000000;
-  LCDCmd(x);
-  }
+  bLcdX=x;
+  bLcdY=y;
+ }
 }
 
 void LCDWriteStringXY(uint8_t x, uint8_t y, const char *msg){
@@ -267,5 +466,10 @@ void LCDWriteStringXY(uint8_t x, uint8_t y, const char *msg){
 	LCDWriteString(msg);
 }
 
+void LCDWriteStringXY_P(uint8_t x, uint8_t y, const char *msg){
+	LCDGotoXY(x, y);
+	LCDWriteString_P(msg);
+}
+
 
 
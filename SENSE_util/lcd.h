@@ -38,6 +38,16 @@
 #define LCD_RW_POS 	PB4
 
 
+#ifndef LCD_COLS
+	#define LCD_COLS	16
+#endif
+#ifndef LCD_ROWS
+	#define LCD_ROWS	2
+#endif
+#ifndef LCD_TX_SIZE
+	#define LCD_TX_SIZE	32		//transmit queue entries, power of two
+#endif
+
 //************************************************
 
 #define LS_BLINK 0B00000001
@@ -61,14 +71,26 @@ void LCDWriteString(const char *msg);
 void LCDWriteInt(int val,unsigned int field_length);
 void LCDGotoXY(uint8_t x,uint8_t y);
 void LCDWriteStringXY(uint8_t x, uint8_t y, const char *msg);
+void LCDWriteString_P(const char *msg);
+void LCDWriteStringXY_P(uint8_t x, uint8_t y, const char *msg);
+void LCDWriteChar(char c);
+void LCDCursorShift(int8_t n);
+void LCDFrameClear(void);
+void LCDFlush(void);
+uint8_t LCDDefineChar(uint8_t code, const uint8_t *rows);
+void LCDQueue(uint8_t c,uint8_t isdata);
+uint8_t LCDTask(void);
+uint8_t LCDTxPending(void);
+uint8_t LCDTxFree(void);
 
 //Low level
 void LCDByte(uint8_t,uint8_t);
 
-#define LCDCmd(command) (LCDByte(command,0))
-#define LCDData(data) (LCDByte(data,1))
+#define LCDCmd(command) (LCDQueue(command,0))		//queued: sent by LCDTask()
+#define LCDData(data) (LCDQueue(data,1))
 
 void LCDBusyLoop();
+uint8_t LCDIsBusy();
 
 
 
@@ -82,8 +104,11 @@ void LCDBusyLoop();
 /***************************************************
 	M A C R O S
 ***************************************************/
-#define LCDClear() LCDCmd(0b00000001);
-#define LCDHome() LCDCmd(0b00000010);
+#define LCDClear() LCDFrameClear();		// shadow buffer: the LCD is updated by LCDFlush()
+#define LCDHome() LCDGotoXY(0,0);
+
+//Character code of a custom character: 8..15 mirror CGRAM 0..7 and, unlike 0, fit in a string
+#define LCD_CGRAM_CHAR(code) ((char)(8+((code)&0x07)))
 
 
 #define LCDWriteIntXY(x,y,val,fl) {\
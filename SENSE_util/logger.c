@@ -0,0 +1,76 @@
+/**
+ * \file logger.c
+ * \brief Background EEPROM writer, main file.
+ */
+
+#include "logger.h"
+#ifndef EEPROM_H_
+  #include "EEPROM.h"
+#endif
+
+
+static logger_job ljaQueue[LOGGER_QUEUE_SIZE];
+static uint8_t bLogHead;				///< Job being committed.
+static uint8_t bLogCount;				///< Jobs in the queue, the one being committed included.
+static uint16_t wLogRetries;			///< Transactions of the current job refused in a row.
+static uint16_t wLogErrors;				///< Jobs dropped after LOGGER_MAX_RETRIES (saturates).
+
+
+/// Copies the block into the queue; returns 0 if the queue is full or the block too long.
+uint8_t logger_push( uint32_t address, uint8_t *data, uint8_t length ){
+	logger_job *ljJob;
+	uint8_t i;
+	
+	if(( bLogCount >= LOGGER_QUEUE_SIZE )||( length > LOGGER_JOB_SIZE )) return 0;
+	
+	ljJob = &ljaQueue[(bLogHead + bLogCount) % LOGGER_QUEUE_SIZE];
+	ljJob->lAddress = address;
+	ljJob->bLength = length;
+	ljJob->bDone = 0;
+	for(i=0; i<length; i++) ljJob->baData[i] = data[i];
+	bLogCount++;
+	return 1;
+}
+
+
+/// One step of the commit: at most one I2C transaction.
+void logger_task( void ){
+	logger_job *ljJob;
+	uint8_t bWritten;
+	
+	if( !bLogCount ) return;
+	
+	ljJob = &ljaQueue[bLogHead];
+	bWritten = EEPROM_writeChunk(ljJob->lAddress + ljJob->bDone, &ljJob->baData[ljJob->bDone],
+								 ljJob->bLength - ljJob->bDone);		// 0 while the chip is busy
+	if( bWritten ){
+		ljJob->bDone += bWritten;
+		wLogRetries = 0;
+	}else if( ++wLogRetries >= LOGGER_MAX_RETRIES ){		// not a write cycle any more: give the job up
+		ljJob->bDone = ljJob->bLength;
+		wLogRetries = 0;
+		if( wLogErrors < UINT16_MAX ) wLogErrors++;
+	}
+	
+	if( ljJob->bDone >= ljJob->bLength ){
+		bLogHead = (bLogHead + 1) % LOGGER_QUEUE_SIZE;
+		bLogCount--;
+	}
+}
+
+
+/// Queue depth.
+uint8_t logger_pending( void ){
+	return bLogCount;
+}
+
+
+uint8_t logger_free( void ){
+	return LOGGER_QUEUE_SIZE - bLogCount;
+}
+
+
+/// Jobs dropped because the EEPROM never acknowledged them.
+uint16_t logger_errors( void ){
+	return wLogErrors;
+}
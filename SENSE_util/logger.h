@@ -0,0 +1,38 @@
+/**
+ * \file logger.h
+ * \brief Background EEPROM writer, header file.
+ *
+ * Blocks of bytes to be written are queued by logger_push() and committed by
+ * logger_task(), called once per main loop pass: every call performs at most
+ * one I2C transaction (EEPROM_writeChunk) and never waits for the write
+ * cycle, so the rest of the main loop keeps running while a record is saved.
+ * A job the chip keeps refusing (missing chip, bus fault) is dropped after
+ * LOGGER_MAX_RETRIES transactions in a row and counted by logger_errors().
+ * Main loop only.
+ */
+
+#ifndef LOGGER_H_
+#define LOGGER_H_
+
+#include <stdint.h>
+
+#define LOGGER_QUEUE_SIZE	4
+#define LOGGER_JOB_SIZE		48		///< Largest block of contiguous bytes.
+#define LOGGER_MAX_RETRIES	1000	///< Refused transactions in a row: a write cycle (5 ms) costs far fewer.
+
+
+typedef struct{
+	uint32_t lAddress;					///< EEPROM address of the first byte.
+	uint8_t bLength;
+	uint8_t bDone;						///< Bytes already committed.
+	uint8_t baData[LOGGER_JOB_SIZE];
+} logger_job;
+
+
+uint8_t logger_push( uint32_t address, uint8_t *data, uint8_t length );
+void logger_task( void );
+uint8_t logger_pending( void );
+uint8_t logger_free( void );
+uint16_t logger_errors( void );
+
+#endif // LOGGER_H_
@@ -0,0 +1,82 @@
+/**
+ * \file memcheck.c
+ * \brief Stack high-water mark and SRAM budget, main file.
+ */
+
+#include <avr/pgmspace.h>
+#include "memcheck.h"
+#include "uart.h"
+#include "format.h"
+
+extern uint8_t __data_start;
+extern uint8_t __data_end;
+extern uint8_t __bss_start;
+extern uint8_t __bss_end;
+extern uint8_t __heap_start;
+extern uint8_t __stack;
+extern char *__brkval __attribute__((weak));		///< avr-libc malloc() break, absent without malloc().
+
+
+/**
+ * \brief Paints the free SRAM, from the end of .bss up to the top of the stack.
+ *
+ * Runs in .init1: the stack pointer is not set yet and r1 is not zero, so no
+ * C code here, only registers.
+ */
+void mem_paint( void ) __attribute__((naked, used, section(".init1")));
+void mem_paint( void ){
+	__asm volatile(
+		"	ldi r30, lo8(__heap_start)	\n"
+		"	ldi r31, hi8(__heap_start)	\n"
+		"	ldi r24, %0					\n"
+		"	ldi r25, hi8(__stack)		\n"
+		"	rjmp 2f						\n"
+		"1:	st Z+, r24					\n"
+		"2:	cpi r30, lo8(__stack)		\n"
+		"	cpc r31, r25				\n"
+		"	brlo 1b						\n"
+		"	breq 1b						\n"
+		:: "M" (MEM_PAINT)
+	);
+}
+
+
+/// Bytes never reached by the stack: from the top of the heap to the first overwritten one.
+uint16_t mem_stackFree( void ){
+	uint8_t *p = (&__brkval && __brkval) ? (uint8_t*)__brkval : &__heap_start;
+	uint16_t wCount = 0;
+	
+	while( p <= &__stack && *p == MEM_PAINT ){ p++; wCount++; }
+	return wCount;
+}
+
+
+void mem_getReport( mem_report *mr ){
+	uint8_t *pHeapEnd = (&__brkval && __brkval) ? (uint8_t*)__brkval : &__heap_start;
+	
+	mr->wData = &__data_end - &__data_start;
+	mr->wBss = &__bss_end - &__bss_start;
+	mr->wHeap = pHeapEnd - &__heap_start;
+	mr->wFree = mem_stackFree();
+	mr->wStackMax = (&__stack - pHeapEnd) + 1 - mr->wFree;
+}
+
+
+/// SRAM budget on the serial port, bytes.
+void mem_dump( void ){
+	mem_report mrNow;
+	char caLine[48];
+	char *p;
+	
+	mem_getReport(&mrNow);
+	p = fmt_uint(fmt_str_P(caLine, PSTR("data ")), mrNow.wData, 0, ' ');
+	p = fmt_uint(fmt_str_P(p, PSTR(" bss ")), mrNow.wBss, 0, ' ');
+	p = fmt_uint(fmt_str_P(p, PSTR(" heap ")), mrNow.wHeap, 0, ' ');
+	fmt_str_P(p, PSTR("\r\n"));
+	uart_puts(caLine);
+	p = fmt_uint(fmt_str_P(caLine, PSTR("stack max ")), mrNow.wStackMax, 0, ' ');
+	p = fmt_uint(fmt_str_P(p, PSTR(" free ")), mrNow.wFree, 0, ' ');
+	p = fmt_uint(fmt_str_P(p, PSTR(" of ")), (uint16_t)(&__stack - &__data_start) + 1, 0, ' ');
+	fmt_str_P(p, PSTR("\r\n"));
+	uart_puts(caLine);
+}
@@ -0,0 +1,32 @@
+/**
+ * \file memcheck.h
+ * \brief Stack high-water mark and SRAM budget, header file.
+ *
+ * The free SRAM between the end of .bss (or of the heap) and the top of the
+ * stack is painted with MEM_PAINT before main() runs; the bytes still holding
+ * the pattern were never reached by the stack. Section sizes come from the
+ * symbols of the avr-libc linker script.
+ */
+
+#ifndef MEMCHECK_H_
+#define MEMCHECK_H_
+
+#include <stdint.h>
+
+#define MEM_PAINT				0xC5
+
+
+typedef struct{
+	uint16_t wData;				///< Initialized globals.
+	uint16_t wBss;				///< Zeroed globals.
+	uint16_t wHeap;				///< malloc() arena, 0 if malloc() is not linked.
+	uint16_t wStackMax;			///< Deepest stack seen since reset (high-water mark).
+	uint16_t wFree;				///< Never touched bytes between heap and stack.
+} mem_report;
+
+
+uint16_t mem_stackFree( void );
+void mem_getReport( mem_report *mr );
+void mem_dump( void );
+
+#endif // MEMCHECK_H_
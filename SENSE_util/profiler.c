@@ -0,0 +1,107 @@
+/**
+ * \file profiler.c
+ * \brief Interrupt and main loop profiler on Timer1, main file.
+ */
+
+#include <avr/pgmspace.h>
+#include "profiler.h"
+#include "uart.h"
+#include "format.h"
+
+#ifdef PROFILER_ENABLED
+
+volatile uint16_t waProfStart[PROF_NUMBER_OF_SLOTS];
+static volatile prof_stats psaProf[PROF_NUMBER_OF_SLOTS];
+
+static const char caProfNames[PROF_NUMBER_OF_SLOTS][6] PROGMEM = {
+	"T0", "T0lat", "ADC", "T2", "PCINT", "Event", "Log", "UI"
+};
+
+
+void prof_init( void ){
+	TCCR1A = 0;
+	TCCR1B = (1<<CS11);				// normal mode, F_CPU/8: 0.5us per tick at 16 MHz
+	prof_reset();
+}
+
+
+void prof_reset( void ){
+	uint8_t i, j;
+	
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+		for(i=0; i<PROF_NUMBER_OF_SLOTS; i++){
+			psaProf[i].wMin = 0xFFFF;
+			psaProf[i].wMax = 0;
+			psaProf[i].lSum = 0;
+			psaProf[i].wCount = 0;
+			for(j=0; j<PROF_HIST_BUCKETS; j++) psaProf[i].waHist[j] = 0;
+		}
+	}
+}
+
+
+/// Called from the handler being measured: interrupts context or main with the slot of its own.
+void prof_record( uint8_t slot, uint16_t ticks ){
+	volatile prof_stats *ps = &psaProf[slot];
+	uint16_t wBucket = ticks >> 5;			// 32 ticks = 16us at 16 MHz
+	uint8_t b = 0;
+	
+	if( ticks < ps->wMin ) ps->wMin = ticks;
+	if( ticks > ps->wMax ) ps->wMax = ticks;
+	ps->lSum += ticks;
+	if( ++ps->wCount == 0x8000 ){			// keep the average moving instead of overflowing
+		ps->wCount >>= 1;
+		ps->lSum >>= 1;
+	}
+	while( wBucket && b < PROF_HIST_BUCKETS-1 ){ wBucket >>= 1; b++; }
+	if( ps->waHist[b] < 0xFFFF ) ps->waHist[b]++;
+}
+
+
+/// Consistent copy of a slot, for the main loop.
+void prof_get( uint8_t slot, prof_stats *ps ){
+	uint8_t j;
+	
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+		ps->wMin = psaProf[slot].wMin;
+		ps->wMax = psaProf[slot].wMax;
+		ps->lSum = psaProf[slot].lSum;
+		ps->wCount = psaProf[slot].wCount;
+		for(j=0; j<PROF_HIST_BUCKETS; j++) ps->waHist[j] = psaProf[slot].waHist[j];
+	}
+}
+
+
+const char *prof_name( uint8_t slot ){
+	return caProfNames[slot];
+}
+
+
+/// One line per slot on the serial port: times in us, then the histogram.
+void prof_dump( void ){
+	prof_stats psSlot;
+	char caLine[48];
+	char *p;
+	uint8_t i, j;
+	
+	uart_puts_P(PSTR("slot  n  min max avg [us] | <16 <32 <64 <128 <256 <512 <1024 more\r\n"));
+	for(i=0; i<PROF_NUMBER_OF_SLOTS; i++){
+		prof_get(i, &psSlot);
+		if( !psSlot.wCount ) psSlot.wMin = 0;
+		p = fmt_str_P(caLine, caProfNames[i]);
+		while( p < caLine+5 ) p = fmt_char(p, ' ');
+		p = fmt_uint(fmt_char(p, ' '), psSlot.wCount, 0, ' ');
+		p = fmt_uint(fmt_char(p, ' '), PROF_TICKS_TO_US(psSlot.wMin), 0, ' ');
+		p = fmt_uint(fmt_char(p, ' '), PROF_TICKS_TO_US(psSlot.wMax), 0, ' ');
+		p = fmt_uint(fmt_char(p, ' '), (psSlot.wCount)?PROF_TICKS_TO_US(psSlot.lSum / psSlot.wCount):0, 0, ' ');
+		fmt_str_P(p, PSTR(" |"));
+		uart_puts(caLine);
+		for(j=0; j<PROF_HIST_BUCKETS; j++){
+			fmt_uint(fmt_char(caLine, ' '), psSlot.waHist[j], 0, ' ');
+			uart_puts(caLine);
+		}
+		uart_puts_P(PSTR("\r\n"));
+	}
+}
+
+#endif // PROFILER_ENABLED
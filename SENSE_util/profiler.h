@@ -0,0 +1,61 @@
+/**
+ * \file profiler.h
+ * \brief Interrupt and main loop profiler on Timer1, header file.
+ *
+ * Instrumentation build only (PROFILER_ENABLED): PROF_ENTER()/PROF_EXIT()
+ * read the free running Timer1 (F_CPU/8) at the edges of a handler and keep
+ * min, max, average and a histogram of the durations in SRAM. Without
+ * PROFILER_ENABLED the macros are empty and Timer1 is left alone.
+ * Interrupts do not nest, so one start time per slot is enough.
+ */
+
+#ifndef PROFILER_H_
+#define PROFILER_H_
+
+#include <stdint.h>
+
+/*  profiler slots  */
+#define PROF_TIMER0				0		// RTC / button scan interrupt
+#define PROF_TIMER0_LATENCY		1		// TCNT0 at the entry of the Timer0 interrupt
+#define PROF_ADC				2
+#define PROF_TIMER2				3		// asynchronous RTC
+#define PROF_PCINT				4
+#define PROF_EVENTS				5		// main: event handlers
+#define PROF_LOGGER				6		// main: background EEPROM writer
+#define PROF_UI					7		// main: state machine pass
+#define PROF_NUMBER_OF_SLOTS	8
+
+#define PROF_HIST_BUCKETS		8		///< <16us, <32us, ... <1024us, longer (16 MHz).
+#define PROF_TICKS_TO_US(t)		((uint32_t)(t) * 8 / (F_CPU / 1000000UL))
+
+
+typedef struct{
+	uint16_t wMin;
+	uint16_t wMax;
+	uint32_t lSum;						///< Halved together with wCount, see prof_record().
+	uint16_t wCount;
+	uint16_t waHist[PROF_HIST_BUCKETS];
+} prof_stats;
+
+
+#ifdef PROFILER_ENABLED
+  #define PROF_ENTER(slot)		waProfStart[slot] = TCNT1
+  #define PROF_EXIT(slot)		prof_record((slot), TCNT1 - waProfStart[slot])
+  #define PROF_SAMPLE(slot, t)	prof_record((slot), (t))
+#else
+  #define PROF_ENTER(slot)
+  #define PROF_EXIT(slot)
+  #define PROF_SAMPLE(slot, t)
+#endif
+
+
+extern volatile uint16_t waProfStart[PROF_NUMBER_OF_SLOTS];
+
+void prof_init( void );
+void prof_reset( void );
+void prof_record( uint8_t slot, uint16_t ticks );
+void prof_get( uint8_t slot, prof_stats *ps );
+const char *prof_name( uint8_t slot );		// in flash
+void prof_dump( void );
+
+#endif // PROFILER_H_
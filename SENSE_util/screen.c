@@ -0,0 +1,68 @@
+/**
+ * \file screen.c
+ * \brief Table driven screen layouts, main file.
+ */
+
+#include <avr/pgmspace.h>
+#include "screen.h"
+#include "lcd.h"
+
+
+static void vDrawField( const screen_field *sf ){
+	char caText[LCD_COLS+1];
+	uint8_t n = 0;
+	
+	caText[0] = '\0';
+	sf->fFormat(caText);
+	LCDGotoXY(sf->bX, sf->bY);
+	while( caText[n] ) LCDWriteChar(caText[n++]);
+	while( n++ < sf->bWidth ) LCDWriteChar(' ');
+}
+
+
+/**
+ * \brief Draws the fields whose update flag is set.
+ *
+ * A flag is cleared before its fields are formatted: if an interrupt sets it
+ * again meanwhile, the fields are drawn once more at the next call.
+ */
+void screen_render( const screen_field *table, uint8_t count ){
+	screen_field sfField;
+	volatile uint8_t *pFlag;
+	uint8_t i, j;
+	
+	for(i=0; i<count; i++){
+		memcpy_P(&sfField, &table[i], sizeof(screen_field));
+		pFlag = sfField.pFlag;
+		if( !*pFlag ) continue;
+		*pFlag = 0;
+		for(j=i; j<count; j++){			// the following fields with this flag have not been drawn yet
+			memcpy_P(&sfField, &table[j], sizeof(screen_field));
+			if( sfField.pFlag == pFlag ) vDrawField(&sfField);
+		}
+	}
+}
+
+
+/// Every field of the screen will be drawn (entering the screen, after LCDClear()).
+void screen_invalidate( const screen_field *table, uint8_t count ){
+	screen_field sfField;
+	uint8_t i;
+	
+	for(i=0; i<count; i++){
+		memcpy_P(&sfField, &table[i], sizeof(screen_field));
+		*sfField.pFlag = 1;
+	}
+}
+
+
+uint8_t screen_pending( const screen_field *table, uint8_t count ){
+	screen_field sfField;
+	uint8_t i;
+	
+	for(i=0; i<count; i++){
+		memcpy_P(&sfField, &table[i], sizeof(screen_field));
+		if( *sfField.pFlag ) return 1;
+	}
+	return 0;
+}
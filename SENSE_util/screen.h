@@ -0,0 +1,38 @@
+/**
+ * \file screen.h
+ * \brief Table driven screen layouts, header file.
+ *
+ * A screen is a PROGMEM table of fields: position, width, a formatter that
+ * writes the text of the field and the update flag that asks for a redraw.
+ * screen_render() draws only the fields whose flag is set and clears the
+ * flags; fields sharing a flag are drawn together. The text goes to the LCD
+ * framebuffer, so unchanged characters cost nothing on the bus.
+ */
+
+#ifndef SCREEN_H_
+#define SCREEN_H_
+
+#include <stdint.h>
+
+#define SCREEN_FIELDS(table)	(sizeof(table)/sizeof((table)[0]))
+
+
+typedef struct{
+	uint8_t				bX;
+	uint8_t				bY;
+	uint8_t				bWidth;					///< Shorter text is padded with blanks up to here.
+	void				(*fFormat)(char *dst);	///< Writes the text of the field, at most LCD_COLS characters.
+	volatile uint8_t	*pFlag;					///< Redraw request, set by whoever changes the source.
+} screen_field;
+
+typedef struct{
+	const screen_field	*pFields;				///< PROGMEM table.
+	uint8_t				bCount;
+} screen_view;
+
+
+void screen_render( const screen_field *table, uint8_t count );
+void screen_invalidate( const screen_field *table, uint8_t count );
+uint8_t screen_pending( const screen_field *table, uint8_t count );
+
+#endif // SCREEN_H_
@@ -0,0 +1,107 @@
+/**
+ * \file stats.c
+ * \brief Streaming statistics, main file.
+ *
+ * Every update costs a handful of integer operations, one 32 bit division and one
+ * 16x16->32 bit multiplication, whatever the number of samples already accumulated.
+ * The mean carries STATS_MEAN_SHIFT fractional bits so that late samples, whose
+ * weight is 1/n, still move it.
+ */
+
+#include "stats.h"
+
+
+void stats_reset( volatile running_stats *rs ){
+	rs->wCount = 0;
+	rs->lMean = 0;
+	rs->lM2 = 0;
+	rs->iMin = INT16_MAX;
+	rs->iMax = INT16_MIN;
+	rs->bMinHour = 0;
+	rs->bMinMin = 0;
+	rs->bMaxHour = 0;
+	rs->bMaxMin = 0;
+}
+
+
+/// Distance from the mean, Q(STATS_MEAN_SHIFT) --> Q(STATS_M2_SHIFT), rounded and clamped to int16_t.
+static int16_t iM2Delta( int32_t delta ){
+	delta = (delta + (1L << (STATS_MEAN_SHIFT - STATS_M2_SHIFT - 1))) >> (STATS_MEAN_SHIFT - STATS_M2_SHIFT);
+	if( delta > INT16_MAX ) return INT16_MAX;
+	if( delta < -INT16_MAX ) return -INT16_MAX;
+	return delta;
+}
+
+
+void stats_update( volatile running_stats *rs, int16_t value, uint8_t hour, uint8_t min ){
+	int32_t lX, lDelta, lStep;
+	uint32_t lInc;
+	
+	if( value < rs->iMin ){
+		rs->iMin = value;
+		rs->bMinHour = hour;
+		rs->bMinMin = min;
+	}
+	if( value > rs->iMax ){
+		rs->iMax = value;
+		rs->bMaxHour = hour;
+		rs->bMaxMin = min;
+	}
+	
+	if( rs->wCount == 0xFFFF ) return;		// saturated: keep the statistics of the first 65535 samples
+	rs->wCount++;
+	
+	/* Welford: delta is taken against the old mean, the second factor against the new one.
+	 * Both have the same sign, so the M2 increment is never negative. The product is
+	 * 16x16 bit (one MUL sequence on the AVR), not a 64 bit library call.  */
+	lX = (int32_t)value << STATS_MEAN_SHIFT;
+	lDelta = lX - rs->lMean;
+	if( lDelta < 0 ) lStep = (lDelta - (int32_t)(rs->wCount>>1)) / (int32_t)rs->wCount;		// rounded
+	else lStep = (lDelta + (int32_t)(rs->wCount>>1)) / (int32_t)rs->wCount;
+	rs->lMean += lStep;
+	lInc = (int32_t)iM2Delta(lDelta) * iM2Delta(lX - rs->lMean);
+	
+	if( rs->lM2 + lInc < rs->lM2 ) rs->lM2 = UINT32_MAX;
+	else rs->lM2 += lInc;
+}
+
+
+int16_t stats_mean( volatile running_stats *rs ){
+	if( rs->wCount == 0 ) return STATS_NO_DATA;
+	
+	if( rs->lMean < 0 )			// round to nearest, both signs
+		return -((-rs->lMean + (1<<(STATS_MEAN_SHIFT-1))) >> STATS_MEAN_SHIFT);
+	return (rs->lMean + (1<<(STATS_MEAN_SHIFT-1))) >> STATS_MEAN_SHIFT;
+}
+
+
+/// Sample variance in unit^2, rounded (0 with less than two samples).
+uint32_t stats_variance( volatile running_stats *rs ){
+	if( rs->wCount < 2 ) return 0;
+	return (rs->lM2 / (rs->wCount - 1) + (1 << (2*STATS_M2_SHIFT - 1))) >> (2*STATS_M2_SHIFT);
+}
+
+
+/// Sample standard deviation in the same unit as the samples.
+uint16_t stats_stdDev( volatile running_stats *rs ){
+	return stats_isqrt(stats_variance(rs));
+}
+
+
+uint16_t stats_isqrt( uint32_t x ){
+	uint32_t lRes = 0;
+	uint32_t lBit = 1UL << 30;
+	
+	while( lBit > x ) lBit >>= 2;
+	
+	while( lBit != 0 ){
+		if( x >= lRes + lBit ){
+			x -= lRes + lBit;
+			lRes = (lRes >> 1) + lBit;
+		}else{
+			lRes >>= 1;
+		}
+		lBit >>= 2;
+	}
+	return lRes;
+}
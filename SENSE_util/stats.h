@@ -0,0 +1,49 @@
+/**
+ * \file stats.h
+ * \brief Streaming statistics, header file.
+ *
+ * O(1) running statistics (count, mean, variance, min and max with their time
+ * of the day) computed with Welford's method in fixed point, so that they can be
+ * updated from inside an interrupt without float arithmetic.
+ * Samples are int16_t values expressed in tenths of unit (0.1 C, 0.1 %RH).
+ *
+ * The M2 update is a 16x16 --> 32 bit product: the two deltas from the mean
+ * carry STATS_M2_SHIFT fractional bits and are clamped to int16_t, so a sample
+ * farther than STATS_MAX_SPREAD from the mean (819.1 C, 8191 mV) counts as
+ * if it were that far. M2 saturates at 2^28 unit^2: a day of samples (8640 at
+ * 10 s) is exact up to a standard deviation of 176 units (17.6 C), a full
+ * count of 65535 samples up to 64 units; beyond that the variance stops growing.
+ */
+
+#ifndef STATS_H_
+#define STATS_H_
+
+#include <stdint.h>
+
+#define STATS_MEAN_SHIFT	15			///< Fractional bits of the running mean: any int16_t sample still fits 32 bit.
+#define STATS_M2_SHIFT		2			///< Fractional bits of the deltas of the M2 update, M2 is Q(2*STATS_M2_SHIFT).
+#define STATS_MAX_SPREAD	(INT16_MAX >> STATS_M2_SHIFT)	///< Largest distance from the mean seen by the M2 update.
+#define STATS_NO_DATA		0x7FFF		///< Returned by the getters when no sample was taken.
+
+
+typedef struct{
+	uint16_t	wCount;			///< Number of samples (saturates at 0xFFFF).
+	int32_t		lMean;			///< Running mean, Q(STATS_MEAN_SHIFT).
+	uint32_t	lM2;			///< Sum of squared differences from the mean, Q(2*STATS_M2_SHIFT) unit^2, saturated.
+	int16_t		iMin;
+	int16_t		iMax;
+	uint8_t		bMinHour;		///< Time of the day the minimum was reached.
+	uint8_t		bMinMin;
+	uint8_t		bMaxHour;		///< Time of the day the maximum was reached.
+	uint8_t		bMaxMin;
+} running_stats;
+
+
+void stats_reset( volatile running_stats *rs );
+void stats_update( volatile running_stats *rs, int16_t value, uint8_t hour, uint8_t min );
+int16_t stats_mean( volatile running_stats *rs );
+uint32_t stats_variance( volatile running_stats *rs );
+uint16_t stats_stdDev( volatile running_stats *rs );
+uint16_t stats_isqrt( uint32_t x );
+
+#endif // STATS_H_
@@ -0,0 +1,96 @@
+/**
+ * \file timer.c
+ * \brief Software timers on the RTC tick, main file.
+ *
+ * timer_tick() runs in the RTC interrupt; timer_start() and timer_stop() can
+ * be called from the main loop (they lock the wheel) or from an expiry.
+ */
+
+#include <util/atomic.h>
+#include "timer.h"
+
+
+static soft_timer *paWheel[TIMER_WHEEL_SLOTS];	///< Armed timers, one list per slot.
+static soft_timer *pTimerDue;					///< Expired in the current tick, callbacks not run yet.
+static uint8_t bWheelNow;						///< Slot of the current tick.
+
+
+static void vWheelLink( soft_timer *t, uint16_t ticks ){
+	if( !ticks ) ticks = 1;				// the earliest expiry is the next tick
+	t->bSlot = (bWheelNow + ticks) & TIMER_WHEEL_MASK;
+	t->wRounds = (ticks - 1) >> TIMER_WHEEL_SHIFT;
+	t->pNext = paWheel[t->bSlot];
+	paWheel[t->bSlot] = t;
+	t->bState = TIMER_WHEEL;
+}
+
+/// Takes \a t off its slot, or off the due list: a due timer restarted or stopped does not fire.
+static void vWheelUnlink( soft_timer *t ){
+	soft_timer **pp;
+	
+	if( t->bState == TIMER_IDLE ) return;
+	pp = (t->bState == TIMER_DUE)?&pTimerDue:&paWheel[t->bSlot];
+	while( *pp && *pp != t ) pp = &(*pp)->pNext;
+	if( *pp ) *pp = t->pNext;
+	t->bState = TIMER_IDLE;
+}
+
+
+/**
+ * \brief Arms \a t to expire in \a ticks, then every \a period ticks (0: once).
+ *
+ * An armed timer is restarted from now.
+ */
+void timer_start( soft_timer *t, uint16_t ticks, uint16_t period, void (*expire)(void) ){
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+		vWheelUnlink(t);
+		t->wPeriod = period;
+		t->fExpire = expire;
+		vWheelLink(t, ticks);
+	}
+}
+
+
+void timer_stop( soft_timer *t ){
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+		vWheelUnlink(t);
+	}
+}
+
+
+uint8_t timer_armed( soft_timer *t ){
+	return t->bState != TIMER_IDLE;
+}
+
+
+/**
+ * \brief Advances the wheel by one tick and runs the expired timers.
+ *
+ * The due timers are moved off the slot first, then popped one at a time: an
+ * expiry can start or stop any timer, a due one included, without disturbing
+ * the walk.
+ */
+void timer_tick( void ){
+	soft_timer **pp, *t;
+	
+	bWheelNow = (bWheelNow + 1) & TIMER_WHEEL_MASK;
+	pp = &paWheel[bWheelNow];
+	while( (t = *pp) ){
+		if( t->wRounds ){
+			t->wRounds--;
+			pp = &t->pNext;
+		}else{
+			*pp = t->pNext;
+			t->bState = TIMER_DUE;
+			t->pNext = pTimerDue;
+			pTimerDue = t;
+		}
+	}
+	
+	while( (t = pTimerDue) ){
+		pTimerDue = t->pNext;
+		t->bState = TIMER_IDLE;
+		if( t->wPeriod ) vWheelLink(t, t->wPeriod);
+		t->fExpire();
+	}
+}
@@ -0,0 +1,42 @@
+/**
+ * \file timer.h
+ * \brief Software timers on the RTC tick, header file.
+ *
+ * Hashed timing wheel: a timer due in n ticks is linked into slot
+ * (now+n) % TIMER_WHEEL_SLOTS with the number of full turns still to wait.
+ * Every tick only visits the timers of one slot, so the cost of a tick does
+ * not grow with the timeouts armed elsewhere on the wheel. Timers are owned by
+ * the caller (no allocation), one-shot or periodic.
+ */
+
+#ifndef TIMER_H_
+#define TIMER_H_
+
+#include <stdint.h>
+
+#define TIMER_WHEEL_SLOTS	16			///< Must be a power of two.
+#define TIMER_WHEEL_MASK	(TIMER_WHEEL_SLOTS-1)
+#define TIMER_WHEEL_SHIFT	4			///< log2(TIMER_WHEEL_SLOTS)
+
+/*  soft_timer.bState  */
+#define TIMER_IDLE			0
+#define TIMER_WHEEL			1			///< Linked into a slot of the wheel.
+#define TIMER_DUE			2			///< Expired in this tick, waiting for its callback.
+
+
+typedef struct soft_timer{
+	struct soft_timer	*pNext;			///< Next timer of the same slot (or of the due list).
+	uint16_t			wRounds;		///< Full turns of the wheel still to wait.
+	uint16_t			wPeriod;		///< Ticks between two expiries, 0 --> one-shot.
+	void				(*fExpire)(void);	///< Runs inside the tick interrupt: short, or post an event.
+	uint8_t				bSlot;
+	uint8_t				bState;			///< TIMER_IDLE, TIMER_WHEEL, TIMER_DUE.
+} soft_timer;
+
+
+void timer_start( soft_timer *t, uint16_t ticks, uint16_t period, void (*expire)(void) );
+void timer_stop( soft_timer *t );
+uint8_t timer_armed( soft_timer *t );
+void timer_tick( void );
+
+#endif // TIMER_H_
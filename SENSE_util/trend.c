@@ -0,0 +1,46 @@
+/**
+ * \file trend.c
+ * \brief Recent samples history and sparkline glyphs, main file.
+ */
+
+#include "trend.h"
+
+
+void trend_push( trend_history *th, int16_t value ){
+	th->iaValues[th->bHead] = value;
+	if( ++th->bHead >= TREND_SIZE ) th->bHead = 0;
+	if( th->bCount < TREND_SIZE ) th->bCount++;
+}
+
+
+/**
+ * \brief Pixel rows (top first, 5 bits each) of one custom character of the sparkline.
+ *
+ * glyph 0 holds the oldest samples. While the ring is filling up the bars are
+ * right aligned, so the newest sample is always the last column. Every sample
+ * is at least one pixel high; a flat window is drawn at half height.
+ */
+void trend_glyph( trend_history *th, uint8_t glyph, uint8_t *rows ){
+	int16_t iMin = 0x7FFF, iMax = -0x7FFF;
+	uint8_t bFirst = TREND_SIZE - th->bCount;		// columns still empty on the left
+	uint8_t bOldest = (th->bHead + TREND_SIZE - th->bCount) % TREND_SIZE;
+	uint8_t bCol, bPos, bHeight, r;
+	int16_t iValue;
+	
+	for(r=0; r<TREND_GLYPH_ROWS; r++) rows[r] = 0;
+	
+	for(bPos=0; bPos<th->bCount; bPos++){
+		iValue = th->iaValues[(bOldest + bPos) % TREND_SIZE];
+		if( iValue < iMin ) iMin = iValue;
+		if( iValue > iMax ) iMax = iValue;
+	}
+	
+	for(bCol=0; bCol<TREND_GLYPH_COLS; bCol++){
+		bPos = glyph*TREND_GLYPH_COLS + bCol;
+		if( bPos < bFirst ) continue;
+		iValue = th->iaValues[(bOldest + bPos - bFirst) % TREND_SIZE];
+		if( iMax == iMin ) bHeight = TREND_GLYPH_ROWS/2;
+		else bHeight = 1 + (uint8_t)(((int32_t)(iValue - iMin) * (TREND_GLYPH_ROWS-1)) / (iMax - iMin));
+		for(r=TREND_GLYPH_ROWS-bHeight; r<TREND_GLYPH_ROWS; r++) rows[r] |= 0x10 >> bCol;
+	}
+}
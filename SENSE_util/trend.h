@@ -0,0 +1,34 @@
+/**
+ * \file trend.h
+ * \brief Recent samples history and sparkline glyphs, header file.
+ *
+ * A small ring of the last TREND_SIZE samples of a channel, filled by the
+ * acquisition path, and the conversion of the ring into HD44780 custom
+ * characters (5x8): one pixel column per sample, oldest on the left, bars
+ * scaled between the minimum and the maximum of the window.
+ */
+
+#ifndef TREND_H_
+#define TREND_H_
+
+#include <stdint.h>
+
+#define TREND_GLYPH_COLS		5
+#define TREND_GLYPH_ROWS		8
+#ifndef TREND_GLYPHS
+#define TREND_GLYPHS			4			///< Custom characters per channel: two channels use all the CGRAM.
+#endif
+#define TREND_SIZE				(TREND_GLYPHS * TREND_GLYPH_COLS)
+
+
+typedef struct{
+	int16_t		iaValues[TREND_SIZE];
+	uint8_t		bHead;			///< Next slot to be written.
+	uint8_t		bCount;			///< Samples in the ring, up to TREND_SIZE.
+} trend_history;
+
+
+void trend_push( trend_history *th, int16_t value );
+void trend_glyph( trend_history *th, uint8_t glyph, uint8_t *rows );
+
+#endif // TREND_H_
@@ -0,0 +1,32 @@
+/**
+ * \file uart.c
+ * \brief Minimal USART0 transmitter (diagnostics output), main file.
+ */
+
+#include <avr/pgmspace.h>
+#include "uart.h"
+
+
+void uart_init( void ){
+	UBRR0 = (F_CPU / 16 / UART_BAUD) - 1;
+	UCSR0B = (1<<TXEN0);
+	UCSR0C = (1<<UCSZ01)|(1<<UCSZ00);		// 8N1
+}
+
+
+void uart_putc( char c ){
+	while( !(UCSR0A & (1<<UDRE0)) );
+	UDR0 = c;
+}
+
+
+void uart_puts( const char *s ){
+	while( *s ) uart_putc(*s++);
+}
+
+
+void uart_puts_P( const char *s ){
+	char c;
+	
+	while(( c = pgm_read_byte(s++) )) uart_putc(c);
+}
@@ -0,0 +1,24 @@
+/**
+ * \file uart.h
+ * \brief Minimal USART0 transmitter (diagnostics output), header file.
+ *
+ * TX only, 8N1, polled: meant for dumps requested from the menu, never for
+ * the interrupts. PD1 (TXD) is free on this board.
+ */
+
+#ifndef UART_H_
+#define UART_H_
+
+#include <stdint.h>
+
+#ifndef UART_BAUD
+#define UART_BAUD		38400UL
+#endif
+
+
+void uart_init( void );
+void uart_putc( char c );
+void uart_puts( const char *s );
+void uart_puts_P( const char *s );
+
+#endif // UART_H_
@@ -0,0 +1,25 @@
+/**
+ * \file io.h
+ * \brief Host register shim for the LCD simulator.
+ *
+ * Only what lcd.c touches: the ports are plain variables, the HD44780 model
+ * samples them at every _delay_us() of the driver (see util/delay.h).
+ */
+
+#ifndef SIM_AVR_IO_H_
+#define SIM_AVR_IO_H_
+
+#include <stdint.h>
+
+extern volatile uint8_t PORTB, DDRB, PINB;
+extern volatile uint8_t PORTD, DDRD, PIND;
+
+#define PB0		0
+#define PB1		1
+#define PB2		2
+#define PB3		3
+#define PB4		4
+#define PB5		5
+#define PD7		7
+
+#endif // SIM_AVR_IO_H_
@@ -0,0 +1,18 @@
+/**
+ * \file pgmspace.h
+ * \brief Host shim: program memory is ordinary memory.
+ */
+
+#ifndef SIM_AVR_PGMSPACE_H_
+#define SIM_AVR_PGMSPACE_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#define PROGMEM
+#define PSTR(s)				(s)
+#define pgm_read_byte(a)	(*(const uint8_t*)(a))
+#define pgm_read_word(a)	(*(const uint16_t*)(a))
+#define memcpy_P(d,s,n)		memcpy((d),(s),(n))
+
+#endif // SIM_AVR_PGMSPACE_H_
@@ -0,0 +1,220 @@
+/**
+ * \file hd44780.c
+ * \brief Behavioral model of an HD44780 in 4 bit mode, main file.
+ */
+
+#include <string.h>
+#include "avr/io.h"
+#include "hd44780.h"
+
+#define PIN_E		(1<<PD7)		// PORTD
+#define PIN_RS		(1<<PB5)		// PORTB
+#define PIN_RW		(1<<PB4)		// PORTB
+
+volatile uint8_t PORTB, DDRB, PINB;
+volatile uint8_t PORTD, DDRD, PIND;
+
+static uint8_t baDdram[0x80];
+static uint8_t baCgram[64];
+static uint8_t bAddress;			// address counter
+static uint8_t bCgramMode;			// last address set was a CGRAM one
+static uint8_t bIncrement;			// entry mode I/D
+static uint8_t bDisplayCtrl;		// display on / cursor / blink
+static uint8_t bFourBit;
+static uint8_t bSecondNibble;		// 4 bit mode: next transfer is the low nibble
+static uint8_t bHighNibble;
+static uint8_t bLastE;
+static uint8_t bLastData;
+static uint8_t bLastBusy;
+static double dNow;					// model time, us
+static double dBusyUntil;
+static double dLastBusyRead;
+static hd44780_stats stStats;
+
+
+void hd44780_reset( void ){
+	memset(baDdram, ' ', sizeof(baDdram));
+	memset(baCgram, 0, sizeof(baCgram));
+	bAddress = 0;
+	bCgramMode = 0;
+	bIncrement = 1;
+	bDisplayCtrl = 0;
+	bFourBit = 0;					// 8 bit interface after power on
+	bSecondNibble = 0;
+	bLastE = 0;
+	bLastBusy = 0;
+	dNow = 0;
+	dBusyUntil = 0;
+	hd44780_clear_stats();
+}
+
+
+/// DDRAM of a two line display: 0x00..0x27 and 0x40..0x67, wrapping from one line to the other.
+static void vStep( void ){
+	if( bCgramMode ){
+		bAddress = (bAddress + (bIncrement ? 1 : -1)) & 0x3F;
+		return;
+	}
+	if( bIncrement ){
+		if( bAddress == 0x27 ) bAddress = 0x40;
+		else if( bAddress == 0x67 ) bAddress = 0x00;
+		else bAddress++;
+	}else{
+		if( bAddress == 0x00 ) bAddress = 0x67;
+		else if( bAddress == 0x40 ) bAddress = 0x27;
+		else bAddress--;
+	}
+}
+
+
+static void vInstruction( uint8_t c ){
+	double dExec = HD44780_EXEC_US;
+	
+	stStats.lCommands++;
+	if( c & 0x80 ){								// set DDRAM address
+		bAddress = c & 0x7F;
+		bCgramMode = 0;
+	}else if( c & 0x40 ){						// set CGRAM address
+		bAddress = c & 0x3F;
+		bCgramMode = 1;
+	}else if( c & 0x20 ){						// function set
+		bFourBit = !(c & 0x10);
+	}else if( c & 0x10 ){						// cursor / display shift: only the cursor is modelled
+		if( !(c & 0x08) ){
+			uint8_t bEntry = bIncrement;
+			bIncrement = (c & 0x04) ? 1 : 0;	// R/L
+			vStep();
+			bIncrement = bEntry;
+		}
+	}else if( c & 0x08 ){						// display control
+		bDisplayCtrl = c & 0x07;
+	}else if( c & 0x04 ){						// entry mode
+		bIncrement = (c & 0x02) ? 1 : 0;
+	}else if( c & 0x02 ){						// return home
+		bAddress = 0;
+		bCgramMode = 0;
+		dExec = HD44780_EXEC_LONG_US;
+	}else if( c & 0x01 ){						// clear display
+		memset(baDdram, ' ', sizeof(baDdram));
+		bAddress = 0;
+		bCgramMode = 0;
+		bIncrement = 1;
+		dExec = HD44780_EXEC_LONG_US;
+	}
+	dBusyUntil = dNow + dExec;
+}
+
+
+static void vWrite( uint8_t c ){
+	stStats.lData++;
+	if( bCgramMode ) baCgram[bAddress] = c & 0x1F;
+	else baDdram[bAddress] = c;
+	vStep();
+	dBusyUntil = dNow + HD44780_EXEC_US + 4;	// tADD
+}
+
+
+static uint8_t bStatus( void ){
+	return ((dNow < dBusyUntil) ? 0x80 : 0) | (bAddress & 0x7F);
+}
+
+
+/// Samples the pins: the driver has just changed them and is now waiting.
+static void vSample( void ){
+	uint8_t bE = (PORTD & PIN_E) ? 1 : 0;
+	uint8_t bRead = (PORTB & PIN_RW) ? 1 : 0;
+	uint8_t bNibble, bValue, bBusy;
+	
+	if( bE && !bLastE && bRead ){				// read: drive the data lines
+		if( !bSecondNibble ){
+			bValue = bStatus();
+			bBusy = (bValue & 0x80) ? 1 : 0;
+			stStats.lStatusReads++;
+			if( bBusy ){
+				stStats.lBusyReads++;
+				if( bLastBusy ) stStats.dBusyWaitUs += dNow - dLastBusyRead;
+			}
+			bLastBusy = bBusy;
+			dLastBusyRead = dNow;
+			bHighNibble = bValue;
+			bNibble = bValue >> 4;
+		}else{
+			bNibble = bHighNibble & 0x0F;
+		}
+		PINB = (PINB & 0xF0) | bNibble;
+	}
+	if( !bE && bLastE ){						// falling edge: end of a transfer
+		if( bRead ){
+			if( bFourBit ) bSecondNibble ^= 1;
+		}else{
+			bNibble = bLastData & 0x0F;
+			if( !bFourBit ){
+				vInstruction(bNibble << 4);		// 8 bit mode, D0-D3 not connected
+			}else if( !bSecondNibble ){
+				bHighNibble = bNibble;
+				bSecondNibble = 1;
+			}else{
+				bSecondNibble = 0;
+				bValue = (bHighNibble << 4) | bNibble;
+				if( PORTB & PIN_RS ) vWrite(bValue);
+				else vInstruction(bValue);
+				bLastBusy = 0;
+			}
+		}
+	}
+	bLastE = bE;
+	bLastData = PORTB;
+}
+
+
+void hd44780_delay_us( double us ){
+	vSample();
+	dNow += us;
+	stStats.dBusUs += us;
+}
+
+
+/// Time passing without the driver touching the bus (the rest of the main loop).
+void hd44780_advance_us( double us ){
+	dNow += us;
+}
+
+
+/// The 16 visible characters of each line; custom characters as '0'..'7', the degree sign as 'o'.
+void hd44780_render( char *row0, char *row1 ){
+	uint8_t x, c;
+	char *row;
+	
+	for(row=row0; row; row=(row==row0)?row1:0){
+		for(x=0; x<16; x++){
+			c = baDdram[((row==row0)?0x00:0x40) + x];
+			if( c < 16 ) c = '0' + (c & 0x07);
+			else if( c == 0xDF ) c = 'o';
+			else if( c < ' ' || c > '~' ) c = '?';
+			row[x] = c;
+		}
+		row[16] = '\0';
+	}
+}
+
+
+const uint8_t *hd44780_cgram( uint8_t code ){
+	return &baCgram[(code & 0x07) << 3];
+}
+
+
+/// Address counter, where the cursor is shown.
+uint8_t hd44780_cursor( void ){
+	return bAddress;
+}
+
+
+void hd44780_get_stats( hd44780_stats *st ){
+	*st = stStats;
+}
+
+
+void hd44780_clear_stats( void ){
+	memset(&stStats, 0, sizeof(stStats));
+	bLastBusy = 0;
+}
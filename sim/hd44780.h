@@ -0,0 +1,42 @@
+/**
+ * \file hd44780.h
+ * \brief Behavioral model of an HD44780 in 4 bit mode, header file.
+ *
+ * Host side only. The model watches the port variables of the register shim
+ * (data on PB0-3, RS on PB5, RW on PB4, E on PD7, as in lcd.h): nibbles are
+ * latched on the falling edge of E, the busy flag and the address counter are
+ * driven on PINB when E rises in read mode. It keeps DDRAM, CGRAM, address
+ * counter, entry mode, display control and the execution time of every
+ * instruction, and counts the bus traffic so the cost of a screen update can
+ * be measured.
+ */
+
+#ifndef HD44780_H_
+#define HD44780_H_
+
+#include <stdint.h>
+
+#define HD44780_EXEC_US			37.0		///< Most instructions and data writes (270 kHz oscillator).
+#define HD44780_EXEC_LONG_US	1520.0		///< Clear display, return home.
+
+
+typedef struct{
+	uint32_t	lCommands;			///< Instructions executed.
+	uint32_t	lData;				///< Data bytes written (DDRAM or CGRAM).
+	uint32_t	lStatusReads;		///< Busy flag reads.
+	uint32_t	lBusyReads;			///< Busy flag reads that found the LCD busy.
+	double		dBusyWaitUs;		///< Time spent polling a busy LCD.
+	double		dBusUs;				///< Time spent by the driver on the bus (all its delays).
+} hd44780_stats;
+
+
+void hd44780_reset( void );
+void hd44780_delay_us( double us );
+void hd44780_advance_us( double us );
+void hd44780_render( char *row0, char *row1 );
+const uint8_t *hd44780_cgram( uint8_t code );
+uint8_t hd44780_cursor( void );
+void hd44780_get_stats( hd44780_stats *st );
+void hd44780_clear_stats( void );
+
+#endif // HD44780_H_
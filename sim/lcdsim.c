@@ -0,0 +1,262 @@
+/**
+ * \file lcdsim.c
+ * \brief Host simulator of the display path: screens and editor driving the HD44780 model.
+ *
+ * SENSE_ui.c (the screen tables, editor descriptors and their callbacks) and
+ * the display modules it uses are built unchanged against the register shim
+ * in sim/avr and sim/util, the same unity build as SENSE.h. This file only
+ * provides what SENSE.c provides to them: measures and settings with fixed
+ * values, a clock that stands still, the logger queue depth. Every frame is
+ * rendered, flushed and drained the way the main loop does, then the 2x16
+ * text and the bus cost are printed:
+ *
+ *     make -C sim && sim/lcdsim
+ *
+ * lcdsim.expected is the output of the current tree: `make -C sim check`
+ * fails when a change moves a field, changes a text or the LCD traffic of a
+ * screen. After an intended change, regenerate it and commit it with the change:
+ *
+ *     make -C sim && sim/lcdsim > sim/lcdsim.expected
+ */
+
+#include <stdio.h>
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include <util/delay.h>
+#include <util/atomic.h>
+#include "lcd.c"
+#include "format.c"
+#include "screen.c"
+#include "editor.c"
+#include "trend.c"
+#include "stats.c"
+#include "calendar.c"
+#include "../SENSE_ui.c"
+
+#define SIM_PASS_US		25.0		///< Main loop pass without LCD work (events, logger, state machine).
+#define SIM_MAX_PASSES	1000		///< A frame not drained by then is reported as stuck.
+
+
+/*  What SENSE.c provides to the screens: simulated measures, clock and logger  */
+volatile int16_t iaChannelValue[ADC_NUMBER_OF_CHANNELS]={215, 450};
+volatile int16_t iDewPoint=91;
+volatile uint16_t wAbsHumidity=86;
+trend_history thTemp, thHum;
+running_stats rsHumToday, rsTempToday, rsHumYesterday, rsTempYesterday;
+volatile uint8_t bHumOnThreshold=45;
+volatile uint8_t bHumAlarmThreshold=60;
+volatile uint16_t wLogInterval=15;
+volatile uint8_t bLogMode=LOG_MODE_PERIODIC;
+
+static time_date tClock={ 0, 0, 34, 12, 19, 10, 26 };
+static uint8_t bLoggerDepth;
+static uint8_t bNewDays;				///< vNewDay() calls: a commitDate() to another day.
+static uint8_t bSettings;				///< SETTING_* bits reported by the commits.
+
+void getTime(time_date *t){
+	*t = tClock;
+}
+
+void setTime(time_date *t){
+	tClock = *t;
+}
+
+void vNewDay(void){
+	bNewDays++;
+}
+
+void vLogSettingsChanged(uint8_t setting){
+	bSettings |= setting;
+}
+
+uint8_t logger_pending(void){
+	return bLoggerDepth;
+}
+
+
+/*  Main loop  */
+static const screen_field *pScreen;		///< Table drawn at every pass outside the idle screen.
+static uint8_t bScreenCount;
+static uint8_t bIdle;					///< refreshQuote() draws the idle screen.
+
+/// One pass of the state machine: refreshQuote() in idle, screen_render() of the page otherwise.
+static void vRender( void ){
+	if( bIdle ) refreshQuote();
+	else if( pScreen ) screen_render(pScreen, bScreenCount);
+}
+
+static uint8_t bPending( void ){
+	if( LCDTxPending() ) return 1;
+	if( bIdle ) return isIdleScreenPending();
+	return pScreen && screen_pending(pScreen, bScreenCount);
+}
+
+/// Back to the idle screen, as the menu exit does.
+static void vShowIdle( void ){
+	bIdle = 1;
+	pScreen = NULL;
+	LCDClear();
+	invalidateIdleScreen();
+}
+
+/// Next idle view, as BTN_B does.
+static void vNextIdleView( void ){
+	if( ++bIdleView >= NUMBER_OF_IDLE_VIEWS ) bIdleView = IDLE_VIEW_MEASURES;
+	LCDWriteStringXY_P(0,1, PSTR("                "));
+	invalidateIdleScreen();
+}
+
+static void vShow( const screen_field *table, uint8_t count ){
+	bIdle = 0;
+	pScreen = table;
+	bScreenCount = count;
+	LCDClear();
+	screen_invalidate(table, count);
+}
+
+/// Runs main loop passes until nothing is left to draw or send, then prints the frame.
+static void vFrame( const char *name ){
+	hd44780_stats st;
+	char caRow0[17], caRow1[17];
+	uint16_t wPasses = 0;
+
+	do{
+		vRender();
+		LCDFlush();
+		LCDTask();
+		hd44780_advance_us(SIM_PASS_US);
+		wPasses++;
+	}while( bPending() && wPasses < SIM_MAX_PASSES );
+
+	hd44780_render(caRow0, caRow1);
+	hd44780_get_stats(&st);
+	printf("%-14s |%s| cmd %3lu data %3lu status %3lu busy %3lu  bus %7.1f us  passes %u%s\n",
+			name, caRow0, (unsigned long)st.lCommands, (unsigned long)st.lData,
+			(unsigned long)st.lStatusReads, (unsigned long)st.lBusyReads, st.dBusUs, wPasses,
+			(wPasses < SIM_MAX_PASSES)?"":"  STUCK");
+	printf("%-14s |%s| cursor %02X\n", "", caRow1, hd44780_cursor());
+	hd44780_clear_stats();
+}
+
+static void vPrintGlyph( uint8_t code ){
+	const uint8_t *pGlyph = hd44780_cgram(code);
+	uint8_t r;
+
+	for(r=0; r<8; r++) printf("%14s  %c%c%c%c%c\n", "", (pGlyph[r]&0x10)?'#':'.', (pGlyph[r]&0x08)?'#':'.',
+			(pGlyph[r]&0x04)?'#':'.', (pGlyph[r]&0x02)?'#':'.', (pGlyph[r]&0x01)?'#':'.');
+}
+
+
+int main( void ){
+	uint8_t j;
+
+	hd44780_reset();
+	InitLCD(0);
+	vFrame("init");
+
+	toggleTimeColon();
+	vShowIdle();
+	vFrame("idle");
+
+	toggleTimeColon();						// EV_TICK
+	vFrame("colon");
+
+	toggleTimeColon();
+	tClock.bMin = 35;
+	bTimeChanged = 1;
+	vFrame("minute tick");
+
+	iaChannelValue[ADC_CH_TEMPERATURE] = 216;
+	bTempChanged = 1;
+	bLoggerDepth = 2;						// refreshQuote() notices the queue depth by itself
+	vFrame("new sample");
+
+	iaChannelValue[ADC_CH_HUMIDITY] = 1000;
+	bHumChanged = 1;
+	bLoggerDepth = 0;
+	vFrame("hum 100%");
+
+	vNextIdleView();
+	vFrame("derived");
+
+	for(j=0; j<TREND_SIZE; j++){
+		trend_push(&thTemp, 200 + j);
+		trend_push(&thHum, 450 + ((j & 4)?20:0));
+	}
+	vNextIdleView();
+	vFrame("trend");
+	vPrintGlyph(TREND_TEMP_GLYPH);
+
+	trend_push(&thTemp, 240);
+	trend_push(&thHum, 450);
+	bTrendChanged = 1;
+	vFrame("trend sample");
+
+	bSelectionMenu = 0;
+	vShow(sfMenu, SCREEN_FIELDS(sfMenu));
+	vFrame("menu");
+
+	bSelectionMenu = 1;
+	bSelectionMenuChanged = 1;
+	vFrame("menu down");
+
+	bIdle = 0;
+	pScreen = NULL;
+	tClock.bDay = 31;
+	editor_open(edDate);
+	vFrame("edit date");
+	editor_next();
+	editor_step(-1);						// 31/09 does not exist: the day is clamped to 30
+	vFrame("month down");
+	for(j=0; j<7; j++) editor_step(-1);
+	vFrame("february");
+	editor_next();
+	editor_step(+1);
+	editor_step(+1);
+	vFrame("year 28");
+	editor_next();
+	editor_step(+1);						// leap year: 29 is allowed
+	vFrame("day up");
+	editor_step(+1);						// wraps
+	vFrame("day wrap");
+	editor_commit();
+
+	editor_open(edHumOn);
+	vFrame("edit hum-on");
+	editor_step(+1);
+	vFrame("threshold up");
+	editor_commit();
+
+	editor_open(edLogInterval);
+	vFrame("edit interval");
+	for(j=0; j<5; j++) editor_step(-1);		// 15 --> 1 min, then wraps to 12 h
+	vFrame("interval wrap");
+	editor_commit();
+
+	editor_open(edLogMode);
+	vFrame("edit log mode");
+	editor_step(+1);
+	vFrame("log mode up");
+	editor_commit();
+
+	bIdleView = IDLE_VIEW_MEASURES;
+	vShowIdle();
+	vFrame("menu exit");
+
+	stats_reset(&rsTempToday);
+	bStatsPage = 0;
+	vShow(sfStats, SCREEN_FIELDS(sfStats));
+	vFrame("stats empty");
+	stats_update(&rsTempToday, 198, 6, 12);
+	stats_update(&rsTempToday, 215, 12, 34);
+	stats_update(&rsTempToday, 243, 15, 2);
+	stats_update(&rsTempToday, 221, 18, 40);
+	bStatsChanged = 1;
+	vFrame("stats");
+	vShow(sfStatsDetail, SCREEN_FIELDS(sfStatsDetail));
+	vFrame("stats detail");
+
+	printf("settings: %02u/%02u/%02u hum-on %u interval %u mode %u new days %u changed %02X\n",
+			tClock.bDay, tClock.bMonth, tClock.bYear, bHumOnThreshold, wLogInterval, bLogMode, bNewDays, bSettings);
+	return 0;
+}
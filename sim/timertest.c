@@ -0,0 +1,76 @@
+/**
+ * \file timertest.c
+ * \brief Host test of the timer wheel (SENSE_util/timer.c).
+ *
+ * timer.c is built unchanged; the ticks are counted by hand and every expiry
+ * is checked against the tick it was due at. Exit status 0 when all pass:
+ *
+ *     make -C sim check
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include "timer.c"
+
+#define SAMPLE_PERIOD	10
+#define SILENCE			60			///< A multiple of SAMPLE_PERIOD: both expire on the same tick.
+#define TICKS			400
+
+static uint16_t wNow;
+static uint16_t wFailures;
+static soft_timer tmSample, tmSilence, tmOnce, tmVictim, tmKiller;
+static uint16_t wSampleLast, wSampleCount;
+static uint8_t bVictimStopped;
+
+
+static void vCheck( int ok, const char *what ){
+	if( ok ) return;
+	printf("FAIL tick %3u: %s\n", wNow, what);
+	wFailures++;
+}
+
+static void vSampleExpired( void ){
+	vCheck(wNow - wSampleLast == SAMPLE_PERIOD, "tmSample period");
+	wSampleLast = wNow;
+	wSampleCount++;
+}
+
+/// As vLogSilenceExpired() --> vLogDue(): restarts tmSample, due in this same tick.
+static void vSilenceExpired( void ){
+	vCheck(wNow % SILENCE == 0, "tmSilence period");
+	timer_start(&tmSample, SAMPLE_PERIOD, SAMPLE_PERIOD, vSampleExpired);
+	wSampleLast = wNow;
+	timer_start(&tmSilence, SILENCE, 0, vSilenceExpired);		// re-armed from its own expiry
+}
+
+static void vOnceExpired( void ){
+	vCheck(wNow == 37, "one-shot at 37");
+}
+
+static void vVictimExpired( void ){
+	vCheck(!bVictimStopped, "stopped while due, fired anyway");
+}
+
+/// Stops a timer due in the same tick: it must not fire.
+static void vKillerExpired( void ){
+	bVictimStopped = timer_armed(&tmVictim);		// still waiting for its callback
+	timer_stop(&tmVictim);
+}
+
+
+int main( void ){
+	timer_start(&tmSample, SAMPLE_PERIOD, SAMPLE_PERIOD, vSampleExpired);
+	timer_start(&tmSilence, SILENCE, 0, vSilenceExpired);
+	timer_start(&tmOnce, 37, 0, vOnceExpired);
+	timer_start(&tmVictim, 50, 0, vVictimExpired);
+	timer_start(&tmKiller, 50, 0, vKillerExpired);
+	
+	for(wNow=1; wNow<=TICKS; wNow++) timer_tick();
+	
+	vCheck(wSampleCount >= TICKS/SAMPLE_PERIOD - TICKS/SILENCE && wSampleCount <= TICKS/SAMPLE_PERIOD, "tmSample count");
+	vCheck(!timer_armed(&tmOnce), "one-shot disarmed");
+	vCheck(timer_armed(&tmSample) && timer_armed(&tmSilence), "periodic still armed");
+	
+	printf("timertest: %u ticks, %u failures\n", TICKS, wFailures);
+	return wFailures != 0;
+}
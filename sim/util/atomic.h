@@ -0,0 +1,12 @@
+/**
+ * \file atomic.h
+ * \brief Host shim: no interrupts on the host, the atomic blocks run once.
+ */
+
+#ifndef _UTIL_ATOMIC_H_
+#define _UTIL_ATOMIC_H_
+
+#define ATOMIC_RESTORESTATE		0
+#define ATOMIC_BLOCK(type)		for(uint8_t _bOnce = 1; _bOnce; _bOnce = 0)
+
+#endif // _UTIL_ATOMIC_H_
@@ -0,0 +1,17 @@
+/**
+ * \file delay.h
+ * \brief Host shim: the busy-wait delays advance the time of the HD44780 model.
+ *
+ * lcd.c waits after every change of the control lines, so each delay is also
+ * the moment the model samples the pins (E edges, RS, RW, data nibble).
+ */
+
+#ifndef _UTIL_DELAY_H_
+#define _UTIL_DELAY_H_
+
+#include "hd44780.h"
+
+#define _delay_us(us)		hd44780_delay_us(us)
+#define _delay_ms(ms)		hd44780_delay_us((ms)*1000.0)
+
+#endif // _UTIL_DELAY_H_